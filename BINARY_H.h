@@ -0,0 +1,96 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include "OBJECTID_H.h"
+#include "Utils.h"
+
+// This class tells binary files from text. As in git, a file is binary when its first
+// kScanSize bytes contain a NUL byte: text never has one, while images, archives and
+// executables almost always have one near the start. The scan is a single memchr, which
+// the C library runs with vector instructions and which stops at the first NUL, so even
+// a large text file costs one pass over a few kilobytes.
+//
+// Blob ids name their content, so answers are cached per id and every blob is checked at
+// most once per command, however many diffs, renames and merges look at it. A blob in the
+// object store is checked without reading more than its first kScanSize bytes. The cache
+// may be used from several threads (files are merged on a thread pool).
+class BinaryDetector {
+public:
+    static constexpr size_t kScanSize = 8000;
+
+    BinaryDetector() = default;
+    BinaryDetector(const BinaryDetector&) = delete;
+    BinaryDetector& operator=(const BinaryDetector&) = delete;
+
+    // The process-wide detector used by diff and merge
+    static BinaryDetector& global() {
+        static BinaryDetector detector;
+        return detector;
+    }
+
+    // Check content already in memory (not cached)
+    static bool isBinary(std::string_view content) {
+        return std::memchr(content.data(), '\0', std::min(content.size(), kScanSize)) != nullptr;
+    }
+
+    // Check a blob in the object store ("" stands for no file, which is not binary)
+    bool isBinaryBlob(const std::filesystem::path& objectsDir, const std::string& hash) {
+        if (hash.empty()) {
+            return false;
+        }
+        ObjectId id(hash);
+        bool binary;
+        if (lookup(id, binary)) {
+            return binary;
+        }
+        char head[kScanSize];
+        std::ifstream file(Utils::objectPath(objectsDir, hash), std::ios::binary);
+        file.read(head, kScanSize);
+        binary = isBinary(std::string_view(head, static_cast<size_t>(file.gcount())));
+        remember(id, binary);
+        return binary;
+    }
+
+    // Check the content of a blob that was read already, e.g. a working directory file
+    bool isBinaryContent(const std::string& hash, std::string_view content) {
+        if (hash.empty()) {
+            return isBinary(content);
+        }
+        ObjectId id(hash);
+        bool binary;
+        if (!lookup(id, binary)) {
+            binary = isBinary(content);
+            remember(id, binary);
+        }
+        return binary;
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<ObjectId, bool> known; // Blob id -> binary
+
+    bool lookup(const ObjectId& id, bool& binary) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = known.find(id);
+        if (it == known.end()) {
+            return false;
+        }
+        binary = it->second;
+        return true;
+    }
+
+    void remember(const ObjectId& id, bool binary) {
+        std::lock_guard<std::mutex> lock(mutex);
+        known.emplace(id, binary);
+    }
+};
+
+#endif // BINARY_H
@@ -0,0 +1,117 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// This class builds and queries the changed-path Bloom filters stored in the
+// commit-graph. A commit's filter holds every path that differs from its first parent,
+// plus each of their leading directories, so one probe answers "did this commit touch
+// this file or anything below this directory?" with either "definitely not" or "maybe".
+//
+// A filter is a plain bit array of kBitsPerEntry bits per path (rounded up to whole
+// bytes), probed at kNumHashes positions derived from two seeded murmur3 hashes.
+// An empty filter means the commit changed nothing; commits that change more than
+// kMaxChangedPaths paths get a one-byte all-ones filter, which answers "maybe" for
+// every path.
+class BloomFilter {
+public:
+    static constexpr size_t kBitsPerEntry = 10;
+    static constexpr uint32_t kNumHashes = 7;
+    static constexpr size_t kMaxChangedPaths = 512;
+
+    // Build the filter for a list of changed file paths
+    static std::string build(const std::vector<std::string>& changedPaths) {
+        // Every file path plus its leading directories ("a/b/c" adds "a/b/c", "a/b", "a")
+        std::vector<std::string_view> keys;
+        for (const auto& path : changedPaths) {
+            std::string_view key(path);
+            while (true) {
+                keys.push_back(key);
+                size_t slashPos = key.rfind('/');
+                if (slashPos == std::string_view::npos) break;
+                key = key.substr(0, slashPos);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        if (keys.size() > kMaxChangedPaths) {
+            return std::string(1, '\xff');
+        }
+        std::string filter((keys.size() * kBitsPerEntry + 7) / 8, '\0');
+        size_t bitCount = filter.size() * 8;
+        for (std::string_view key : keys) {
+            uint32_t hash1 = murmur3(key, kSeed1);
+            uint32_t hash2 = murmur3(key, kSeed2);
+            for (uint32_t i = 0; i < kNumHashes; ++i) {
+                size_t bit = (hash1 + i * hash2) % bitCount;
+                filter[bit / 8] |= static_cast<char>(1 << (bit % 8));
+            }
+        }
+        return filter;
+    }
+
+    // Whether the path (a file or a directory) may be in the filter
+    static bool mayContain(const char* filter, size_t size, std::string_view path) {
+        if (size == 0) {
+            return false; // Nothing changed
+        }
+        size_t bitCount = size * 8;
+        uint32_t hash1 = murmur3(path, kSeed1);
+        uint32_t hash2 = murmur3(path, kSeed2);
+        for (uint32_t i = 0; i < kNumHashes; ++i) {
+            size_t bit = (hash1 + i * hash2) % bitCount;
+            if (!(static_cast<unsigned char>(filter[bit / 8]) & (1 << (bit % 8)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kSeed1 = 0x293ae76f;
+    static constexpr uint32_t kSeed2 = 0x7e646e2c;
+
+    // 32-bit murmur3 hash
+    static uint32_t murmur3(std::string_view data, uint32_t seed) {
+        const uint32_t c1 = 0xcc9e2d51, c2 = 0x1b873593;
+        auto rotl = [](uint32_t x, int r) { return (x << r) | (x >> (32 - r)); };
+        uint32_t hash = seed;
+        size_t blocks = data.size() / 4;
+        for (size_t i = 0; i < blocks; ++i) {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data()) + i * 4;
+            uint32_t k = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+            k *= c1;
+            k = rotl(k, 15);
+            k *= c2;
+            hash ^= k;
+            hash = rotl(hash, 13);
+            hash = hash * 5 + 0xe6546b64;
+        }
+        const unsigned char* tail = reinterpret_cast<const unsigned char*>(data.data()) + blocks * 4;
+        uint32_t k = 0;
+        switch (data.size() & 3) {
+            case 3: k ^= tail[2] << 16; [[fallthrough]];
+            case 2: k ^= tail[1] << 8; [[fallthrough]];
+            case 1:
+                k ^= tail[0];
+                k *= c1;
+                k = rotl(k, 15);
+                k *= c2;
+                hash ^= k;
+        }
+        hash ^= static_cast<uint32_t>(data.size());
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+        return hash;
+    }
+};
+
+#endif // BLOOM_H
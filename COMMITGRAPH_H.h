@@ -0,0 +1,730 @@
+#ifndef COMMITGRAPH_H
+#define COMMITGRAPH_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "Utils.h"
+#include "OBJECTID_H.h"
+#include "COMMIT_H.h"
+#include "MAPPEDFILE_H.h"
+#include "TREEDIFF_H.h"
+#include "BLOOM_H.h"
+
+// Dense handle for a commit inside a CommitGraph. Commits stored in the commit-graph
+// file are numbered by their row (sorted id order); other commits get numbers after
+// those, in the order they are first looked up.
+using CommitNode = uint32_t;
+
+// This class answers history queries (parents, root tree, time, generation number)
+// from the commit-graph file, memory-mapped from .minigit/objects/info/commit-graph,
+// and falls back to reading commit object headers for commits written after the file.
+//
+// File layout (integers are little-endian):
+//   0   magic "MGCG", u8 version, u8 chunk count, 2 bytes reserved
+//   8   chunk table: (chunk count + 1) entries of {4-char chunk id, u64 offset};
+//       the last entry has id 0 and the end offset of the last chunk
+//   chunks:
+//   "OIDF" fan-out: 256 x u32, number of commits whose id starts with a byte <= i
+//   "OIDL" commit ids, sorted, ObjectId::kWidth bytes each
+//   "CDAT" one fixed-width row per commit, in the same order:
+//          root tree id (ObjectId::kWidth bytes), u32 first parent, u32 second parent,
+//          u32 generation, u32 reserved, i64 commit time
+//   "EDGE" parent lists for commits with more than two parents
+//   "BIDX" u32 per commit: end offset of its changed-path Bloom filter within BDAT
+//   "BDAT" the Bloom filters (see BloomFilter), back to back in row order
+// A parent is stored as the row number of the parent. kNoParent marks a missing one;
+// a second parent with kExtraEdges set is an index into EDGE, whose list runs up to
+// and including the entry with kLastEdge set.
+class CommitGraph {
+public:
+    static constexpr uint32_t kNoParent = 0x70000000;
+    static constexpr uint32_t kExtraEdges = 0x80000000;
+    static constexpr uint32_t kLastEdge = 0x80000000;
+
+    explicit CommitGraph(const std::filesystem::path& objectsPath) : objectsDir(objectsPath) {
+        load();
+    }
+
+    // Location of the commit-graph file
+    static std::filesystem::path filePath(const std::filesystem::path& objectsPath) {
+        return objectsPath / "info" / "commit-graph";
+    }
+
+    // Number of commits stored in the commit-graph file
+    size_t graphSize() const { return graphCount; }
+
+    // Number of commits known so far (file rows plus commits read from objects)
+    size_t nodeCount() const { return graphCount + extras.size(); }
+
+    // Find the node for a commit hash: a binary search in the file, otherwise the
+    // commit object's header is read once and cached. Returns false for unknown hashes.
+    bool lookup(const std::string& commitHash, CommitNode& node) {
+        if (commitHash.empty() || commitHash.size() > ObjectId::kWidth) {
+            return false;
+        }
+        if (findInFile(ObjectId(commitHash), node)) {
+            return true;
+        }
+        auto it = extraIndex.find(commitHash);
+        if (it != extraIndex.end()) {
+            node = it->second;
+            return true;
+        }
+
+        Extra extra;
+        if (!Commit::readHeader(objectsDir, commitHash, extra.header)) {
+            return false;
+        }
+        extra.hash = commitHash;
+        node = static_cast<CommitNode>(graphCount + extras.size());
+        extras.push_back(std::move(extra));
+        extraIndex[commitHash] = node;
+        return true;
+    }
+
+    std::string hashOf(CommitNode node) const {
+        if (node < graphCount) {
+            return ObjectId(std::string_view(oidl + node * ObjectId::kWidth, ObjectId::kWidth)).toString();
+        }
+        return extras[node - graphCount].hash;
+    }
+
+    std::string treeOf(CommitNode node) const {
+        if (node < graphCount) {
+            return ObjectId(std::string_view(row(node), ObjectId::kWidth)).toString();
+        }
+        return extras[node - graphCount].header.tree;
+    }
+
+    int64_t timeOf(CommitNode node) const {
+        if (node < graphCount) {
+            return static_cast<int64_t>(Utils::readLittleEndian(row(node) + ObjectId::kWidth + 16, 8));
+        }
+        return extras[node - graphCount].header.time;
+    }
+
+    // Generation number: 1 for root commits, otherwise 1 + the largest parent generation.
+    // A commit can only reach commits with a smaller generation number.
+    uint32_t generationOf(CommitNode node) {
+        if (node < graphCount) {
+            return static_cast<uint32_t>(Utils::readLittleEndian(row(node) + ObjectId::kWidth + 8, 4));
+        }
+        if (extras[node - graphCount].generation != 0) {
+            return extras[node - graphCount].generation;
+        }
+
+        // Commits outside the file: compute bottom-up with an explicit stack, stopping at
+        // commits whose generation is already known (in particular, every commit in the file)
+        std::vector<CommitNode> stack{node};
+        std::vector<CommitNode> parents;
+        while (!stack.empty()) {
+            CommitNode top = stack.back();
+            if (top < graphCount || extras[top - graphCount].generation != 0) {
+                stack.pop_back();
+                continue;
+            }
+            parentsOf(top, parents);
+            uint32_t maxParentGeneration = 0;
+            bool parentsReady = true;
+            for (CommitNode parent : parents) {
+                if (parent >= graphCount && extras[parent - graphCount].generation == 0) {
+                    stack.push_back(parent);
+                    parentsReady = false;
+                } else {
+                    maxParentGeneration = std::max(maxParentGeneration, generationOf(parent));
+                }
+            }
+            if (parentsReady) {
+                extras[top - graphCount].generation = maxParentGeneration + 1;
+                stack.pop_back();
+            }
+        }
+        return extras[node - graphCount].generation;
+    }
+
+    // Walk order for history traversals: higher generation first, then later commit
+    // time, then commit id so that the order is total and does not depend on whether
+    // the commits came from the commit-graph file
+    bool newer(CommitNode a, CommitNode b) {
+        uint32_t generationA = generationOf(a), generationB = generationOf(b);
+        if (generationA != generationB) return generationA > generationB;
+        int64_t timeA = timeOf(a), timeB = timeOf(b);
+        if (timeA != timeB) return timeA > timeB;
+        if (a < graphCount && b < graphCount) return a < b; // Rows are in id order
+        return hashOf(a) < hashOf(b);
+    }
+
+    // Parents of a commit, in order (first parent first)
+    void parentsOf(CommitNode node, std::vector<CommitNode>& parents) {
+        parents.clear();
+        if (node < graphCount) {
+            const char* data = row(node) + ObjectId::kWidth;
+            uint32_t first = static_cast<uint32_t>(Utils::readLittleEndian(data, 4));
+            uint32_t second = static_cast<uint32_t>(Utils::readLittleEndian(data + 4, 4));
+            if (first == kNoParent) {
+                return;
+            }
+            parents.push_back(first);
+            if (second == kNoParent) {
+                return;
+            }
+            if (!(second & kExtraEdges)) {
+                parents.push_back(second);
+                return;
+            }
+            for (size_t i = second & ~kExtraEdges; i < edgeCount; ++i) {
+                uint32_t edge = static_cast<uint32_t>(Utils::readLittleEndian(edges + i * 4, 4));
+                parents.push_back(edge & ~kLastEdge);
+                if (edge & kLastEdge) {
+                    break;
+                }
+            }
+            return;
+        }
+
+        size_t index = node - graphCount;
+        if (!extras[index].parentsResolved) {
+            // Looking up a parent may append to extras, so work on a copy of the hashes
+            std::vector<std::string> parentHashes = extras[index].header.parents;
+            std::vector<CommitNode> resolved;
+            for (const auto& parentHash : parentHashes) {
+                CommitNode parent;
+                if (lookup(parentHash, parent)) {
+                    resolved.push_back(parent);
+                }
+            }
+            extras[index].parents = std::move(resolved);
+            extras[index].parentsResolved = true;
+        }
+        parents = extras[index].parents;
+    }
+
+    // Whether a commit may have changed a path (file or directory) compared to its first
+    // parent. A false answer is certain and needs no tree access; commits without a Bloom
+    // filter (not in the file) always answer true.
+    bool mayHaveChanged(CommitNode node, std::string_view path) const {
+        if (node >= graphCount || !bloomIndex) {
+            return true;
+        }
+        size_t begin = node == 0 ? 0 : Utils::readLittleEndian(bloomIndex + (node - 1) * 4, 4);
+        size_t end = Utils::readLittleEndian(bloomIndex + node * 4, 4);
+        if (begin > end || end > bloomDataSize) {
+            return true; // Corrupted index: do not filter
+        }
+        return BloomFilter::mayContain(bloomData + begin, end - begin, path);
+    }
+
+    // Check if ancestorCommit is an ancestor of descendantCommit
+    bool isAncestor(const std::string& ancestorCommitHash, const std::string& descendantCommitHash) {
+        if (ancestorCommitHash.empty() || descendantCommitHash.empty()) return false;
+        if (ancestorCommitHash == descendantCommitHash) return true;
+
+        CommitNode ancestor, descendant;
+        if (!lookup(ancestorCommitHash, ancestor) || !lookup(descendantCommitHash, descendant)) {
+            return false;
+        }
+        return isAncestor(ancestor, descendant);
+    }
+
+    // Reachability between two nodes. Every parent has a smaller generation number than
+    // its child, so no commit with a generation at or below the ancestor's (other than
+    // the ancestor itself) can lead to it: the walk only visits commits between the two
+    // generations instead of the whole history below the descendant.
+    bool isAncestor(CommitNode ancestor, CommitNode descendant) {
+        if (ancestor == descendant) return true;
+        uint32_t minGeneration = generationOf(ancestor);
+        if (generationOf(descendant) <= minGeneration) {
+            return false; // The descendant is not newer than the ancestor
+        }
+
+        std::vector<CommitNode> stack{descendant};
+        std::unordered_set<CommitNode> visited{descendant};
+        std::vector<CommitNode> parents;
+        while (!stack.empty()) {
+            CommitNode current = stack.back();
+            stack.pop_back();
+            parentsOf(current, parents);
+            for (CommitNode parent : parents) {
+                if (parent == ancestor) {
+                    return true; // Found ancestor
+                }
+                if (generationOf(parent) <= minGeneration) {
+                    continue; // Too old to reach the ancestor
+                }
+                if (visited.insert(parent).second) {
+                    stack.push_back(parent);
+                }
+            }
+        }
+        return false; // Not an ancestor
+    }
+
+    // Find the Lowest Common Ancestor (LCA) of two commits: the first of their best
+    // merge bases, or "" if they have none
+    std::string findLCA(const std::string& commit1Hash, const std::string& commit2Hash) {
+        std::vector<std::string> bases = findMergeBases(commit1Hash, commit2Hash);
+        return bases.empty() ? "" : bases.front();
+    }
+
+    // All best common ancestors of two commits (see the node overload)
+    std::vector<std::string> findMergeBases(const std::string& commit1Hash, const std::string& commit2Hash) {
+        std::vector<std::string> bases;
+        CommitNode commit1, commit2;
+        if (commit1Hash.empty() || commit2Hash.empty() ||
+            !lookup(commit1Hash, commit1) || !lookup(commit2Hash, commit2)) {
+            return bases;
+        }
+        for (CommitNode base : findMergeBases(commit1, commit2)) {
+            bases.push_back(hashOf(base));
+        }
+        return bases;
+    }
+
+    // All best common ancestors of two commits, newest first. A common ancestor is "best"
+    // when it is not an ancestor of another common ancestor; criss-cross histories can
+    // have several.
+    //
+    // Both sides are painted down at once, always expanding the newest commit first
+    // (highest generation, then latest commit time), so a commit is only visited after
+    // all of its children. A commit painted from both sides is a candidate, and everything
+    // below it is painted stale. The walk stops as soon as the queue holds only stale
+    // commits, so it touches the commits near the fork point rather than all of history.
+    std::vector<CommitNode> findMergeBases(CommitNode commit1, CommitNode commit2) {
+        if (commit1 == commit2) {
+            return {commit1};
+        }
+
+        enum : uint8_t { kParent1 = 1, kParent2 = 2, kStale = 4, kResult = 8, kQueued = 16 };
+        std::unordered_map<CommitNode, uint8_t> flags;
+        std::vector<CommitNode> queue; // Max-heap ordered by newer()
+        size_t nonStaleQueued = 0;     // Queued commits not painted stale
+        auto older = [this](CommitNode a, CommitNode b) { return newer(b, a); };
+        // Add paint to a commit, queueing it unless it is queued already (then it carries
+        // the new paint on when popped)
+        auto paintCommit = [&](CommitNode node, uint8_t paint) {
+            uint8_t& nodeFlags = flags[node];
+            bool wasStale = nodeFlags & kStale;
+            nodeFlags |= paint;
+            if (!(nodeFlags & kQueued)) {
+                nodeFlags |= kQueued;
+                queue.push_back(node);
+                std::push_heap(queue.begin(), queue.end(), older);
+                if (!(nodeFlags & kStale)) {
+                    ++nonStaleQueued;
+                }
+            } else if (!wasStale && (nodeFlags & kStale)) {
+                --nonStaleQueued;
+            }
+        };
+
+        paintCommit(commit1, kParent1);
+        paintCommit(commit2, kParent2);
+
+        std::vector<CommitNode> candidates;
+        std::vector<CommitNode> parents;
+        while (nonStaleQueued > 0) {
+            std::pop_heap(queue.begin(), queue.end(), older);
+            CommitNode current = queue.back();
+            queue.pop_back();
+            flags[current] &= ~kQueued;
+            if (!(flags[current] & kStale)) {
+                --nonStaleQueued;
+            }
+
+            uint8_t paint = flags[current] & (kParent1 | kParent2 | kStale);
+            if (paint == (kParent1 | kParent2)) {
+                if (!(flags[current] & kResult)) {
+                    flags[current] |= kResult;
+                    candidates.push_back(current);
+                }
+                paint |= kStale; // Ancestors of a common ancestor cannot be best
+            }
+            parentsOf(current, parents);
+            for (CommitNode parent : parents) {
+                if ((flags[parent] & paint) == paint) {
+                    continue; // Already painted with everything we carry
+                }
+                paintCommit(parent, paint);
+            }
+        }
+
+        // Generation order is a topological order, so a candidate's paint is final when it
+        // is popped: no candidate can be an ancestor of another, and no redundancy pass
+        // (as needed with date ordering) is required
+        std::vector<CommitNode> best = std::move(candidates);
+        std::sort(best.begin(), best.end(), [this](CommitNode a, CommitNode b) { return newer(a, b); });
+        return best;
+    }
+
+    // All best common ancestors of a commit and a set of commits taken together (as if
+    // merged into one), newest first: the merge bases with each commit of the set, minus
+    // those that are an ancestor of another
+    std::vector<CommitNode> findMergeBases(const std::vector<CommitNode>& commits, CommitNode other) {
+        std::vector<CommitNode> bases;
+        for (CommitNode commit : commits) {
+            for (CommitNode base : findMergeBases(commit, other)) {
+                if (std::find(bases.begin(), bases.end(), base) == bases.end()) {
+                    bases.push_back(base);
+                }
+            }
+        }
+        std::vector<CommitNode> best;
+        for (CommitNode base : bases) {
+            bool belowAnother = std::any_of(bases.begin(), bases.end(), [&](CommitNode another) {
+                return another != base && isAncestor(base, another);
+            });
+            if (!belowAnother) {
+                best.push_back(base);
+            }
+        }
+        std::sort(best.begin(), best.end(), [this](CommitNode a, CommitNode b) { return newer(a, b); });
+        return best;
+    }
+
+    // How far a tip has diverged from a base: commits only the tip reaches (ahead) and
+    // commits only the base reaches (behind)
+    struct AheadBehind {
+        size_t ahead = 0;
+        size_t behind = 0;
+    };
+
+    // Compute ahead/behind counts of many tips against one base in a single walk.
+    // Every visited commit carries a bitmap with one bit per tip plus one for the base,
+    // recording which of them reach it. Commits are expanded newest first in generation
+    // order, so a commit's bitmap is complete when it is popped; it then counts towards
+    // every tip whose bit differs from the base bit. A commit reached by all of them
+    // counts for nothing and neither do its ancestors, so the walk stops as soon as only
+    // such commits are queued and costs about the commits below the newest fork point,
+    // however many tips there are.
+    std::vector<AheadBehind> aheadBehind(CommitNode base, const std::vector<CommitNode>& tips) {
+        std::vector<AheadBehind> counts(tips.size());
+        const size_t bitCount = tips.size() + 1; // Bit 0 is the base, bit i + 1 is tips[i]
+        const size_t words = (bitCount + 63) / 64;
+        const uint64_t lastWordMask = bitCount % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (bitCount % 64)) - 1;
+
+        // Bitmaps live in fixed-size slots that are recycled once a commit is expanded,
+        // so memory follows the width of the walk rather than the length of the history
+        std::vector<uint64_t> bitmaps;
+        std::vector<size_t> freeSlots;
+        std::unordered_map<CommitNode, size_t> slotOf; // Queued commits
+        std::vector<CommitNode> queue;                 // Max-heap ordered by newer()
+        size_t partialQueued = 0;                      // Queued commits not reached by all
+        auto older = [this](CommitNode a, CommitNode b) { return newer(b, a); };
+        auto isFull = [&](const uint64_t* bits) {
+            for (size_t w = 0; w + 1 < words; ++w) {
+                if (bits[w] != ~uint64_t(0)) return false;
+            }
+            return bits[words - 1] == lastWordMask;
+        };
+        // Merge a bitmap into a commit, queueing the commit the first time it is reached
+        auto paint = [&](CommitNode node, const uint64_t* bits) {
+            auto [it, inserted] = slotOf.emplace(node, 0);
+            if (inserted) {
+                if (!freeSlots.empty()) {
+                    it->second = freeSlots.back();
+                    freeSlots.pop_back();
+                    std::fill_n(bitmaps.begin() + it->second * words, words, 0);
+                } else {
+                    it->second = bitmaps.size() / words;
+                    bitmaps.resize(bitmaps.size() + words, 0);
+                }
+                queue.push_back(node);
+                std::push_heap(queue.begin(), queue.end(), older);
+            } else if (isFull(&bitmaps[it->second * words])) {
+                return;
+            }
+            uint64_t* target = &bitmaps[it->second * words];
+            for (size_t w = 0; w < words; ++w) {
+                target[w] |= bits[w];
+            }
+            bool full = isFull(target);
+            if (inserted && !full) {
+                ++partialQueued;
+            } else if (!inserted && full) {
+                --partialQueued;
+            }
+        };
+
+        std::vector<uint64_t> single(words);
+        auto paintBit = [&](CommitNode node, size_t bit) {
+            std::fill(single.begin(), single.end(), 0);
+            single[bit / 64] = uint64_t(1) << (bit % 64);
+            paint(node, single.data());
+        };
+        paintBit(base, 0);
+        for (size_t i = 0; i < tips.size(); ++i) {
+            paintBit(tips[i], i + 1);
+        }
+
+        std::vector<uint64_t> current(words);
+        std::vector<CommitNode> parents;
+        while (partialQueued > 0) {
+            std::pop_heap(queue.begin(), queue.end(), older);
+            CommitNode node = queue.back();
+            queue.pop_back();
+            size_t slot = slotOf[node];
+            slotOf.erase(node);
+            std::copy_n(bitmaps.begin() + slot * words, words, current.begin());
+            freeSlots.push_back(slot);
+
+            if (!isFull(current.data())) {
+                --partialQueued;
+                // Tips whose bit differs from the base bit: ahead if only the tip has it,
+                // behind if only the base has it
+                bool reachedByBase = current[0] & 1;
+                for (size_t w = 0; w < words; ++w) {
+                    uint64_t differing = reachedByBase ? ~current[w] : current[w];
+                    if (w == 0) differing &= ~uint64_t(1);
+                    if (w + 1 == words) differing &= lastWordMask;
+                    while (differing) {
+                        size_t tip = w * 64 + static_cast<size_t>(__builtin_ctzll(differing)) - 1;
+                        ++(reachedByBase ? counts[tip].behind : counts[tip].ahead);
+                        differing &= differing - 1;
+                    }
+                }
+            }
+            parentsOf(node, parents);
+            for (CommitNode parent : parents) {
+                paint(parent, current.data());
+            }
+        }
+        return counts;
+    }
+
+    // Write a commit-graph file containing every commit reachable from the given tips.
+    // Returns the number of commits written, or -1 on error.
+    static long write(const std::filesystem::path& objectsPath, const std::vector<std::string>& tips) {
+        CommitGraph graph(objectsPath); // Existing file (if any) speeds up the walk
+
+        // Collect all reachable commits
+        std::vector<CommitNode> commits;
+        std::vector<bool> seen;
+        std::vector<CommitNode> stack;
+        for (const auto& tip : tips) {
+            CommitNode node;
+            if (graph.lookup(tip, node)) {
+                stack.push_back(node);
+            }
+        }
+        std::vector<CommitNode> parents;
+        while (!stack.empty()) {
+            CommitNode node = stack.back();
+            stack.pop_back();
+            if (node >= seen.size()) {
+                seen.resize(graph.nodeCount() + 1);
+            }
+            if (seen[node]) continue;
+            seen[node] = true;
+            commits.push_back(node);
+            graph.parentsOf(node, parents);
+            stack.insert(stack.end(), parents.begin(), parents.end());
+        }
+
+        // Rows are sorted by commit id
+        std::vector<std::pair<ObjectId, CommitNode>> sorted;
+        sorted.reserve(commits.size());
+        for (CommitNode node : commits) {
+            sorted.emplace_back(ObjectId(graph.hashOf(node)), node);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::unordered_map<CommitNode, uint32_t> rowOf;
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            rowOf[sorted[i].second] = static_cast<uint32_t>(i);
+        }
+
+        std::string fanout, oidl, cdat, edge, bloomIndexChunk, bloomDataChunk;
+        uint32_t fanoutCounts[256] = {0};
+        for (const auto& [id, node] : sorted) {
+            ++fanoutCounts[static_cast<unsigned char>(id.data()[0])];
+            oidl.append(id.data(), ObjectId::kWidth);
+
+            cdat.append(ObjectId(graph.treeOf(node)).data(), ObjectId::kWidth);
+            graph.parentsOf(node, parents);
+            uint32_t first = parents.size() > 0 ? rowOf[parents[0]] : kNoParent;
+            uint32_t second = parents.size() > 1 ? rowOf[parents[1]] : kNoParent;
+            if (parents.size() > 2) {
+                second = kExtraEdges | static_cast<uint32_t>(edge.size() / 4);
+                for (size_t i = 1; i < parents.size(); ++i) {
+                    uint32_t entry = rowOf[parents[i]] | (i + 1 == parents.size() ? kLastEdge : 0);
+                    Utils::appendLittleEndian(edge, entry, 4);
+                }
+            }
+            Utils::appendLittleEndian(cdat, first, 4);
+            Utils::appendLittleEndian(cdat, second, 4);
+            Utils::appendLittleEndian(cdat, graph.generationOf(node), 4);
+            Utils::appendLittleEndian(cdat, 0, 4); // Reserved
+            Utils::appendLittleEndian(cdat, static_cast<uint64_t>(graph.timeOf(node)), 8);
+
+            bloomDataChunk += graph.changedPathFilter(node);
+            Utils::appendLittleEndian(bloomIndexChunk, bloomDataChunk.size(), 4);
+        }
+        uint32_t cumulative = 0;
+        for (uint32_t count : fanoutCounts) {
+            cumulative += count;
+            Utils::appendLittleEndian(fanout, cumulative, 4);
+        }
+
+        std::vector<std::pair<std::string, const std::string*>> chunks = {
+            {"OIDF", &fanout}, {"OIDL", &oidl}, {"CDAT", &cdat}, {"EDGE", &edge},
+            {"BIDX", &bloomIndexChunk}, {"BDAT", &bloomDataChunk}};
+        std::string content = "MGCG";
+        Utils::appendLittleEndian(content, 1, 1); // Version
+        Utils::appendLittleEndian(content, chunks.size(), 1);
+        Utils::appendLittleEndian(content, 0, 2); // Reserved
+        uint64_t offset = content.size() + (chunks.size() + 1) * 12;
+        for (const auto& [chunkId, chunk] : chunks) {
+            content += chunkId;
+            Utils::appendLittleEndian(content, offset, 8);
+            offset += chunk->size();
+        }
+        Utils::appendLittleEndian(content, 0, 4);
+        Utils::appendLittleEndian(content, offset, 8);
+        for (const auto& chunk : chunks) {
+            content += *chunk.second;
+        }
+
+        // Write to a temporary file and rename it, so readers never see a partial file
+        std::filesystem::path graphPath = filePath(objectsPath);
+        std::filesystem::path tempPath = graphPath;
+        tempPath += ".tmp";
+        std::error_code ec;
+        std::filesystem::create_directories(graphPath.parent_path(), ec);
+        if (!Utils::writeFile(tempPath, content)) {
+            return -1;
+        }
+        std::filesystem::rename(tempPath, graphPath, ec);
+        if (ec) {
+            std::cerr << "Error writing commit-graph: " << ec.message() << std::endl;
+            return -1;
+        }
+        return static_cast<long>(sorted.size());
+    }
+
+private:
+    static constexpr size_t kRowSize = ObjectId::kWidth + 24;
+
+    // A commit that is not in the commit-graph file, read from its object header
+    struct Extra {
+        std::string hash;
+        Commit::Header header;
+        std::vector<CommitNode> parents;
+        bool parentsResolved = false;
+        uint32_t generation = 0; // 0 until computed
+    };
+
+    std::filesystem::path objectsDir;
+    MappedFile file;
+    size_t graphCount = 0;
+    const char* fanout = nullptr;
+    const char* oidl = nullptr;
+    const char* cdat = nullptr;
+    const char* edges = nullptr;
+    size_t edgeCount = 0;
+    const char* bloomIndex = nullptr;
+    const char* bloomData = nullptr;
+    size_t bloomDataSize = 0;
+    std::vector<Extra> extras;
+    std::unordered_map<std::string, CommitNode> extraIndex;
+
+    const char* row(CommitNode node) const { return cdat + node * kRowSize; }
+
+    // The Bloom filter of a commit's changed paths: copied from the file when present,
+    // otherwise built from a diff against the first parent's tree
+    std::string changedPathFilter(CommitNode node) {
+        if (node < graphCount && bloomIndex) {
+            size_t begin = node == 0 ? 0 : Utils::readLittleEndian(bloomIndex + (node - 1) * 4, 4);
+            size_t end = Utils::readLittleEndian(bloomIndex + node * 4, 4);
+            if (begin <= end && end <= bloomDataSize) {
+                return std::string(bloomData + begin, end - begin);
+            }
+        }
+        std::vector<CommitNode> parents;
+        parentsOf(node, parents);
+        std::string parentTree = parents.empty() ? "" : treeOf(parents[0]);
+        std::vector<std::string> changedPaths;
+        for (const auto& change : TreeDiff::diff(objectsDir, parentTree, treeOf(node))) {
+            changedPaths.push_back(change.path);
+        }
+        return BloomFilter::build(changedPaths);
+    }
+
+    // Map the commit-graph file and locate its chunks; a missing or invalid file
+    // simply leaves the graph empty, so every lookup falls back to the object store
+    void load() {
+        if (!file.open(filePath(objectsDir))) {
+            return;
+        }
+        const char* data = file.data();
+        size_t size = file.size();
+        if (size < 8 || std::memcmp(data, "MGCG", 4) != 0 || data[4] != 1) {
+            file.close();
+            return;
+        }
+        size_t chunkCount = static_cast<unsigned char>(data[5]);
+        if (size < 8 + (chunkCount + 1) * 12) {
+            file.close();
+            return;
+        }
+        size_t oidlSize = 0, cdatSize = 0, edgeSize = 0, fanoutSize = 0, bloomIndexSize = 0;
+        for (size_t i = 0; i < chunkCount; ++i) {
+            const char* entry = data + 8 + i * 12;
+            uint64_t begin = Utils::readLittleEndian(entry + 4, 8);
+            uint64_t end = Utils::readLittleEndian(entry + 16, 8);
+            if (begin > end || end > size) {
+                file.close();
+                return;
+            }
+            std::string chunkId(entry, 4);
+            if (chunkId == "OIDF") { fanout = data + begin; fanoutSize = end - begin; }
+            else if (chunkId == "OIDL") { oidl = data + begin; oidlSize = end - begin; }
+            else if (chunkId == "CDAT") { cdat = data + begin; cdatSize = end - begin; }
+            else if (chunkId == "EDGE") { edges = data + begin; edgeSize = end - begin; }
+            else if (chunkId == "BIDX") { bloomIndex = data + begin; bloomIndexSize = end - begin; }
+            else if (chunkId == "BDAT") { bloomData = data + begin; bloomDataSize = end - begin; }
+        }
+        size_t count = oidlSize / ObjectId::kWidth;
+        if (!fanout || fanoutSize != 256 * 4 || !oidl || !cdat || cdatSize != count * kRowSize) {
+            file.close();
+            fanout = oidl = cdat = edges = bloomIndex = bloomData = nullptr;
+            return;
+        }
+        graphCount = count;
+        edgeCount = edgeSize / 4;
+        if (bloomIndexSize != count * 4 || !bloomData) {
+            bloomIndex = bloomData = nullptr; // Bloom filters are optional
+            bloomDataSize = 0;
+        }
+    }
+
+    // Binary search for a commit id within its fan-out bucket
+    bool findInFile(const ObjectId& id, CommitNode& node) const {
+        if (graphCount == 0) {
+            return false;
+        }
+        unsigned char firstByte = static_cast<unsigned char>(id.data()[0]);
+        size_t low = firstByte == 0 ? 0 : Utils::readLittleEndian(fanout + (firstByte - 1) * 4, 4);
+        size_t high = Utils::readLittleEndian(fanout + firstByte * 4, 4);
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            int cmp = std::memcmp(oidl + mid * ObjectId::kWidth, id.data(), ObjectId::kWidth);
+            if (cmp == 0) {
+                node = static_cast<CommitNode>(mid);
+                return true;
+            }
+            if (cmp < 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // COMMITGRAPH_H
@@ -8,19 +8,49 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <queue> // For BFS in isAncestor
-#include <set>   // For visited set in isAncestor
+#include <map>
 #include "Utils.h"
 #include "BLOB_H.h" // Corrected from "Blob.h"
+#include "TREE_H.h"
+#include "OBJECTID_H.h"
 
 class Commit {
+public:
+    // Fields stored in the fixed-size header of a commit object. They can be read
+    // without decoding the author and message, and without touching the tree.
+    struct Header {
+        std::string tree;
+        std::vector<std::string> parents;
+        int64_t time = 0;
+        int tzOffset = 0; // Minutes east of UTC
+    };
+
 private:
+    // Binary commit object layout (integers are little-endian):
+    //   0   magic "MGC1"
+    //   4   u8  number of parents
+    //   5   i16 timezone offset of the author, minutes east of UTC
+    //   7   1 byte reserved (zero)
+    //   8   i64 commit time, seconds since the Unix epoch
+    //   16  u32 offset of the author
+    //   20  u32 offset of the message (which runs to the end of the object)
+    //   24  root tree id, ObjectId::kWidth bytes, NUL-padded
+    //   64  parent ids, ObjectId::kWidth bytes each
+    //   ..  author, message
+    static constexpr char kMagic[4] = {'M', 'G', 'C', '1'};
+    static constexpr size_t kFixedHeaderSize = 24 + ObjectId::kWidth;
+
     std::string hash;
     std::string message;
     std::string author;
-    std::string timestamp;
+    int64_t time = 0; // Seconds since the Unix epoch
+    int tzOffset = 0; // Minutes east of UTC where the commit was made
     std::vector<std::string> parents;  // Support for multiple parents (merge commits)
-    std::unordered_map<std::string, std::string> snapshot; // filepath -> blob hash
+    std::string tree; // Hash of the root tree object
+    // Sorted filepath -> blob hash list, expanded from the root tree only when first requested
+    mutable Snapshot snapshot;
+    mutable bool snapshotLoaded = true;
+    std::filesystem::path objectsDir; // Where to expand the tree from (set when loaded)
     
 public:
     // Constructors
@@ -28,45 +58,52 @@ public:
     
     Commit(const std::string& message, const std::string& author = "Anonymous")
         : message(message), author(author) {
-        timestamp = Utils::getCurrentTimestamp();
+        time = Utils::getCurrentEpoch();
+        tzOffset = Utils::getLocalTimezoneOffset(time);
     }
     
     // Getters
     std::string getHash() const { return hash; }
     std::string getCommitMessage() const { return message; }
     std::string getAuthor() const { return author; }
-    std::string getTimestamp() const { return timestamp; }
+    std::string getTimestamp() const { return Utils::formatTimestamp(time, tzOffset); }
+    int64_t getTime() const { return time; }
+    int getTimezoneOffset() const { return tzOffset; }
+    std::string getTree() const { return tree; }
     const std::vector<std::string>& getParents() const { return parents; }
-    const std::unordered_map<std::string, std::string>& getSnapshot() const { return snapshot; }
+    const Snapshot& getSnapshot() const {
+        if (!snapshotLoaded) {
+            Tree::flatten(objectsDir, tree, "", snapshot);
+            snapshotLoaded = true;
+        }
+        return snapshot;
+    }
 
     // Setters
-    void setHash(const std::string& h) { hash = h; }
     void addParent(const std::string& parentHash) { parents.push_back(parentHash); }
-    void setSnapshot(const std::unordered_map<std::string, std::string>& snap) { snapshot = snap; }
+    void setTime(int64_t epochSeconds, int offsetMinutes) {
+        time = epochSeconds;
+        tzOffset = offsetMinutes;
+    }
+    void setTree(const std::string& treeHash, const std::filesystem::path& objectsPath) {
+        tree = treeHash;
+        objectsDir = objectsPath;
+        snapshot.clear();
+        snapshotLoaded = false;
+    }
 
-    // Create commit from staging area
-    bool createFromStagingArea(const std::filesystem::path& stagingPath,
-                              const std::filesystem::path& objectsPath) {
-        if (!std::filesystem::exists(stagingPath)) {
-            std::cerr << "Staging area does not exist" << std::endl;
-            return false;
-        }
-        
+    // Create commit from staging area: the parent's root tree plus the staged changes.
+    // Only the directories containing staged or removed files are rewritten.
+    bool createFromStagingArea(const Snapshot& index,
+                               const std::string& parentTree,
+                               const std::filesystem::path& objectsPath) {
         try {
-            snapshot.clear(); // Clear existing snapshot for new commit
-            // Recursively process all files in staging area
-            for (const auto& entry : std::filesystem::recursive_directory_iterator(stagingPath)) {
-                if (entry.is_regular_file()) {
-                    std::filesystem::path relativePath = std::filesystem::relative(entry.path(), stagingPath);
-                    std::string fileContent = Utils::readFile(entry.path().string());
-                    std::string blobHash = Utils::computeHash(fileContent); // Recompute hash to ensure consistency
-                    
-                    // Save blob to objects directory if it doesn't exist (or overwrite if content changed)
-                    Utils::writeFile(objectsPath / blobHash, fileContent);
-                    
-                    snapshot[relativePath.string()] = blobHash; // Store relative path and blob hash
-                }
+            std::map<std::string, std::string> changes;
+            for (const auto& entry : index) {
+                // A null id marks a removal, which applyChanges expects as an empty blob hash
+                changes.emplace_hint(changes.end(), entry.path, entry.id.isNull() ? "" : entry.id.toString());
             }
+            setTree(Tree::applyChanges(objectsPath, parentTree, changes), objectsPath);
             return true;
         } catch (const std::exception& e) {
             std::cerr << "Error creating snapshot from staging area: " << e.what() << std::endl;
@@ -74,87 +111,91 @@ public:
         }
     }
 
-    // Save commit object to object store
+    // Save commit object to object store (see the binary layout above).
+    // The commit hash is the hash of the serialized object, so it covers the root tree,
+    // the parents and all metadata: two different commits can only share a hash through
+    // a hash collision, and a commit id can safely be used as a cache key.
     bool saveToObjectStore(const std::filesystem::path& objectsPath) {
-        // Commit content format:
-        // message\n
-        // author\n
-        // timestamp\n
-        // parent1_hash parent2_hash ...\n (empty if no parents)
-        // filepath1 blob_hash1\n
-        // filepath2 blob_hash2\n
-        // ...
-        std::stringstream ss;
-        ss << message << "\n";
-        ss << author << "\n";
-        ss << timestamp << "\n";
-        
-        for (size_t i = 0; i < parents.size(); ++i) {
-            ss << parents[i];
-            if (i < parents.size() - 1) {
-                ss << " ";
-            }
+        if (parents.size() > 255) {
+            std::cerr << "Error: A commit cannot have more than 255 parents." << std::endl;
+            return false;
         }
-        ss << "\n"; // Newline after parents (even if empty)
 
-        for (const auto& pair : snapshot) {
-            ss << pair.first << " " << pair.second << "\n";
+        size_t authorOffset = kFixedHeaderSize + parents.size() * ObjectId::kWidth;
+        size_t messageOffset = authorOffset + author.size();
+
+        std::string commitContent(kMagic, sizeof(kMagic));
+        Utils::appendLittleEndian(commitContent, parents.size(), 1);
+        Utils::appendLittleEndian(commitContent, static_cast<uint16_t>(static_cast<int16_t>(tzOffset)), 2);
+        Utils::appendLittleEndian(commitContent, 0, 1); // Reserved
+        Utils::appendLittleEndian(commitContent, static_cast<uint64_t>(time), 8);
+        Utils::appendLittleEndian(commitContent, authorOffset, 4);
+        Utils::appendLittleEndian(commitContent, messageOffset, 4);
+        commitContent.append(ObjectId(tree).data(), ObjectId::kWidth);
+        for (const auto& parent : parents) {
+            commitContent.append(ObjectId(parent).data(), ObjectId::kWidth);
         }
-        
-        std::string commitContent = ss.str();
-        if (hash.empty()) { // Ensure hash is set before saving
-            hash = Utils::computeHash(commitContent);
+        commitContent += author;
+        commitContent += message;
+
+        hash = Utils::computeHash(commitContent);
+
+        // Objects are immutable: an identical commit already stored is reused as-is
+        if (std::filesystem::exists(Utils::objectPath(objectsPath, hash))) {
+            return true;
         }
-        
-        return Utils::writeFile(objectsPath / hash, commitContent);
+        return Utils::writeObject(objectsPath, hash, commitContent);
     }
 
-    // Load commit object from object store
+    // Load commit object from object store. The snapshot is not expanded here;
+    // it is read from the tree objects on the first call to getSnapshot().
     static Commit loadFromObjectStore(const std::filesystem::path& objectsPath, const std::string& commitHash) {
         Commit commit; // Create an empty commit object
-        std::string commitContent = Utils::readFile(objectsPath / commitHash);
+        std::string commitContent = Utils::readFile(Utils::objectPath(objectsPath, commitHash));
 
-        if (commitContent.empty()) {
-            // std::cerr << "Error: Commit object not found or empty: " << commitHash << std::endl;
+        Header header;
+        if (!decodeHeader(commitContent, header)) {
+            // std::cerr << "Error: Commit object not found or invalid: " << commitHash << std::endl;
             return commit; // Return invalid commit
         }
 
-        std::stringstream ss(commitContent);
-        std::string line;
-
-        std::getline(ss, commit.message); // First line is message
-        std::getline(ss, commit.author);  // Second line is author
-        std::getline(ss, commit.timestamp); // Third line is timestamp
-
-        // Fourth line is parents (space-separated)
-        std::getline(ss, line);
-        if (!line.empty()) {
-            std::stringstream parentSs(line);
-            std::string parentHash;
-            while (parentSs >> parentHash) {
-                commit.parents.push_back(parentHash);
-            }
-        }
-
-        // Remaining lines are snapshot (filepath blob_hash)
-        commit.snapshot.clear();
-        while (std::getline(ss, line)) {
-            std::string filepath;
-            std::string blobHash;
-            size_t spacePos = line.find(' ');
-            if (spacePos != std::string::npos) {
-                filepath = line.substr(0, spacePos);
-                blobHash = line.substr(spacePos + 1);
-                commit.snapshot[filepath] = blobHash;
-            }
+        size_t authorOffset = Utils::readLittleEndian(commitContent.data() + 16, 4);
+        size_t messageOffset = Utils::readLittleEndian(commitContent.data() + 20, 4);
+        if (authorOffset > messageOffset || messageOffset > commitContent.size()) {
+            return commit; // Corrupted object
         }
+        commit.author = commitContent.substr(authorOffset, messageOffset - authorOffset);
+        commit.message = commitContent.substr(messageOffset);
+        commit.time = header.time;
+        commit.tzOffset = header.tzOffset;
+        commit.parents = std::move(header.parents);
+        commit.setTree(header.tree, objectsPath);
         commit.hash = commitHash; // Set the hash of the loaded commit
         return commit;
     }
 
+    // Read only the fixed-size header of a commit object (parents, root tree, time).
+    // History walks use this so they never decode messages or expand snapshots.
+    static bool readHeader(const std::filesystem::path& objectsPath, const std::string& commitHash, Header& header) {
+        std::ifstream inFile(Utils::objectPath(objectsPath, commitHash), std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+        std::string headerBytes(kFixedHeaderSize, '\0');
+        if (!inFile.read(&headerBytes[0], kFixedHeaderSize)) {
+            return false;
+        }
+        size_t parentCount = static_cast<unsigned char>(headerBytes[4]);
+        headerBytes.resize(kFixedHeaderSize + parentCount * ObjectId::kWidth);
+        if (parentCount > 0 && !inFile.read(&headerBytes[kFixedHeaderSize], parentCount * ObjectId::kWidth)) {
+            return false;
+        }
+        return decodeHeader(headerBytes, header);
+    }
+
     // Check if commit object exists in the object store
     static bool existsInObjectStore(const std::filesystem::path& objectsPath, const std::string& commitHash) {
-        return std::filesystem::exists(objectsPath / commitHash);
+        return std::filesystem::is_regular_file(Utils::objectPath(objectsPath, commitHash));
     }
 
     // Check if the commit object is valid (e.g., has a hash and message)
@@ -162,161 +203,26 @@ public:
         return !hash.empty(); // Simple validity check
     }
 
-    // Restore working directory to the state of this commit
-    bool restoreToWorkingDirectory(const std::filesystem::path& workingDir, const std::filesystem::path& objectsPath) {
-        // 1. Clear current working directory (except .minigit)
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(workingDir)) {
-            if (entry.is_regular_file()) {
-                std::filesystem::path relativePath = std::filesystem::relative(entry.path(), workingDir);
-                // Exclude files within .minigit directory
-                if (relativePath.string().rfind(".minigit", 0) != 0 && relativePath.string().rfind(".git", 0) != 0) {
-                    std::filesystem::remove(entry.path());
-                }
-            } else if (entry.is_directory()) {
-                std::filesystem::path relativePath = std::filesystem::relative(entry.path(), workingDir);
-                if (relativePath.string().rfind(".minigit", 0) != 0 && relativePath.string().rfind(".git", 0) != 0) {
-                    // Only remove empty directories, or those that would not be recreated by files.
-                    // This is complex to do perfectly, simple removal can be dangerous.
-                    // For now, only remove files, and let new files create directories.
-                    // Or, if truly clearing, iterate and remove files first, then empty dirs.
-                }
-            }
+private:
+    // Decode the fixed-size header and parent ids at the start of a commit object
+    static bool decodeHeader(const std::string& content, Header& header) {
+        if (content.size() < kFixedHeaderSize || content.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+            return false;
         }
-        // Simplified: delete all files except those in .minigit
-        for (const auto& entry : std::filesystem::directory_iterator(workingDir)) {
-            if (entry.path().filename() != ".minigit" && entry.path().filename() != ".git") {
-                std::filesystem::remove_all(entry.path());
-            }
+        size_t parentCount = static_cast<unsigned char>(content[4]);
+        if (content.size() < kFixedHeaderSize + parentCount * ObjectId::kWidth) {
+            return false;
         }
-
-
-        // 2. Write files from snapshot
-        for (const auto& pair : snapshot) {
-            std::string filepath = pair.first;
-            std::string blobHash = pair.second;
-            std::string fileContent = Utils::readFile(objectsPath / blobHash);
-            
-            std::filesystem::path absoluteFilePath = workingDir / filepath;
-            std::filesystem::create_directories(absoluteFilePath.parent_path()); // Ensure parent directories exist
-            Utils::writeFile(absoluteFilePath.string(), fileContent);
+        header.time = static_cast<int64_t>(Utils::readLittleEndian(content.data() + 8, 8));
+        header.tzOffset = static_cast<int16_t>(Utils::readLittleEndian(content.data() + 5, 2));
+        header.tree = ObjectId(std::string_view(content.data() + 24, ObjectId::kWidth)).toString();
+        header.parents.clear();
+        for (size_t i = 0; i < parentCount; ++i) {
+            const char* id = content.data() + kFixedHeaderSize + i * ObjectId::kWidth;
+            header.parents.push_back(ObjectId(std::string_view(id, ObjectId::kWidth)).toString());
         }
         return true;
     }
-    
-    // Check if ancestorCommit is an ancestor of descendantCommit
-    static bool isAncestor(const std::filesystem::path& objectsPath,
-                           const std::string& ancestorCommitHash,
-                           const std::string& descendantCommitHash) {
-        if (ancestorCommitHash.empty() || descendantCommitHash.empty()) return false;
-        if (ancestorCommitHash == descendantCommitHash) return true;
-
-        std::queue<std::string> q;
-        std::set<std::string> visited;
-
-        q.push(descendantCommitHash);
-        visited.insert(descendantCommitHash);
-
-        while (!q.empty()) {
-            std::string currentHash = q.front();
-            q.pop();
-
-            Commit currentCommit = Commit::loadFromObjectStore(objectsPath, currentHash);
-            if (!currentCommit.isValid()) {
-                // Should not happen if history is valid, but handle corrupted objects
-                continue;
-            }
-
-            for (const std::string& parent : currentCommit.getParents()) {
-                if (parent == ancestorCommitHash) {
-                    return true; // Found ancestor
-                }
-                if (visited.find(parent) == visited.end()) {
-                    visited.insert(parent);
-                    q.push(parent);
-                }
-            }
-        }
-        return false; // Not an ancestor
-    }
-
-    // Find the Lowest Common Ancestor (LCA) of two commits
-    static std::string findLCA(const std::filesystem::path& objectsPath,
-                               const std::string& commit1Hash,
-                               const std::string& commit2Hash) {
-        if (commit1Hash.empty() || commit2Hash.empty()) return "";
-        if (commit1Hash == commit2Hash) return commit1Hash; // If they are the same, that's the LCA
-
-        // BFS from commit1 to find all its ancestors and store their distance
-        std::unordered_map<std::string, int> dist1;
-        std::queue<std::string> q1;
-
-        q1.push(commit1Hash);
-        dist1[commit1Hash] = 0;
-
-        while (!q1.empty()) {
-            std::string currentHash = q1.front();
-            q1.pop();
-            Commit currentCommit = Commit::loadFromObjectStore(objectsPath, currentHash);
-            if (currentCommit.isValid()) {
-                for (const std::string& parent : currentCommit.getParents()) {
-                    if (dist1.find(parent) == dist1.end()) { // If not visited
-                        dist1[parent] = dist1[currentHash] + 1;
-                        q1.push(parent);
-                    }
-                }
-            }
-        }
-
-        // BFS from commit2, checking for common ancestors in dist1
-        std::queue<std::string> q2;
-        q2.push(commit2Hash);
-        std::set<std::string> visited2; // To prevent cycles/revisiting in second BFS
-        visited2.insert(commit2Hash);
-        
-        std::string lca = "";
-        int minDistance = -1; // To find the lowest (closest to the commits) common ancestor
-
-        while (!q2.empty()) {
-            std::string currentHash = q2.front();
-            q2.pop();
-
-            if (dist1.count(currentHash)) { // Found a common ancestor
-                // Since BFS explores level by level, the first one found is a valid LCA.
-                // To get the "lowest" (closest to the diverging branches), we need to check distances.
-                // For a simple LCA, the first one found by BFS from 'newer' commits is usually sufficient.
-                // A more robust LCA would consider all common ancestors and pick the one with max depth.
-                // For simplicity here, let's just pick the first one from q2 that's an ancestor of commit1.
-                // The algorithm provided finds an LCA. To be the *lowest* (deepest in history), it's more complex.
-                // For typical Git behavior, the "closest" LCA is what's needed for merge base.
-                // Let's refine this to find the one closest to *both* commits (which is generally the "true" LCA for merge base)
-
-                // Simple LCA strategy: first found by traversing commit2's history
-                // is fine for finding *a* common ancestor.
-                // For the *lowest* (most recent common parent), a combined BFS/DFS approach or specific LCA algorithms might be needed.
-                // However, the current structure of `findLCA` is typically used to find *any* common ancestor effectively.
-                // A better LCA for Git merges would often involve finding all common ancestors and then picking the "best" one.
-                // For simplicity and given the usage, the first encountered common ancestor from commit2's traversal is acceptable as *an* LCA.
-                // Let's ensure it's indeed the *lowest* (most recent) if possible from this structure.
-                // The current BFS from commit2, when it finds an ancestor of commit1, is effectively finding the LCA.
-                // Because of BFS, it finds the "closest" common ancestor in terms of number of steps from commit2.
-                
-                // Let's return the first common ancestor found by BFS from commit2.
-                // If you need the *deepest* common ancestor, the algorithm needs to be different.
-                return currentHash; 
-            }
-
-            Commit currentCommit = Commit::loadFromObjectStore(objectsPath, currentHash);
-            if (currentCommit.isValid()) {
-                for (const std::string& parent : currentCommit.getParents()) {
-                    if (visited2.find(parent) == visited2.end()) {
-                        visited2.insert(parent);
-                        q2.push(parent);
-                    }
-                }
-            }
-        }
-        return ""; // No common ancestor found
-    }
 };
 
 #endif // COMMIT_H
\ No newline at end of file
@@ -0,0 +1,436 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "OUTPUTBUFFER_H.h"
+
+// Line matching strategy used by LineDiff
+enum class DiffAlgorithm {
+    Myers,     // Shortest edit script (the default)
+    Patience,  // Anchor on lines that occur exactly once on both sides
+    Histogram  // Anchor on the least frequent common lines (patience generalized)
+};
+
+// A run of changed lines: old lines [oldStart, oldStart + oldCount) were replaced by new
+// lines [newStart, newStart + newCount). Line numbers are 0-based.
+struct DiffRegion {
+    size_t oldStart;
+    size_t oldCount;
+    size_t newStart;
+    size_t newCount;
+};
+
+// This class computes the line differences between two texts.
+//
+// Lines (including their '\n') are found with memchr, and the common prefix and suffix
+// of the two texts are located with block-wise memcmp before any line is hashed, so an
+// edit in the middle of a large file only hashes and diffs the lines around it. The
+// remaining lines are numbered by content (equal lines get equal numbers), and the
+// chosen algorithm works on those numbers, marking each line as changed or not.
+//
+// Lines are views into the texts passed to the constructor, which must outlive the diff.
+class LineDiff {
+public:
+    LineDiff(std::string_view oldText, std::string_view newText, DiffAlgorithm algorithm = DiffAlgorithm::Myers)
+        : oldLineList(splitLines(oldText)), newLineList(splitLines(newText)),
+          oldChanged(oldLineList.size(), 0), newChanged(newLineList.size(), 0) {
+        size_t prefix = 0, suffix = 0;
+        trimCommonLines(oldText, newText, prefix, suffix);
+        size_t oldEnd = oldLineList.size() - suffix, newEnd = newLineList.size() - suffix;
+        if (prefix < oldEnd || prefix < newEnd) {
+            numberLines(prefix, oldEnd, newEnd);
+            size_t oldCount = oldEnd - prefix, newCount = newEnd - prefix;
+            switch (algorithm) {
+                case DiffAlgorithm::Myers: myers(0, oldCount, 0, newCount); break;
+                case DiffAlgorithm::Patience: patience(0, oldCount, 0, newCount); break;
+                case DiffAlgorithm::Histogram: histogram(0, oldCount, 0, newCount); break;
+            }
+        }
+        collectRegions();
+    }
+
+    // Split a text into lines, each keeping its '\n' (the last line may lack one)
+    static std::vector<std::string_view> splitLines(std::string_view text) {
+        std::vector<std::string_view> lines;
+        const char* p = text.data();
+        const char* end = text.data() + text.size();
+        while (p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* lineEnd = newline ? newline + 1 : end;
+            lines.emplace_back(p, lineEnd - p);
+            p = lineEnd;
+        }
+        return lines;
+    }
+
+    const std::vector<std::string_view>& oldLines() const { return oldLineList; }
+    const std::vector<std::string_view>& newLines() const { return newLineList; }
+
+    // The changed regions, in order
+    const std::vector<DiffRegion>& regions() const { return regionList; }
+
+    bool identical() const { return regionList.empty(); }
+
+    // Write the hunks of a unified diff ("@@ -a,b +c,d @@" followed by ' ', '-' and '+'
+    // lines), with up to `context` unchanged lines around each change. Changes that are
+    // closer than twice the context share a hunk.
+    void writeUnified(OutputBuffer& out, size_t context) const {
+        size_t r = 0;
+        while (r < regionList.size()) {
+            // Gather the regions of one hunk
+            size_t last = r;
+            while (last + 1 < regionList.size() &&
+                   regionList[last + 1].oldStart - (regionList[last].oldStart + regionList[last].oldCount) <= 2 * context) {
+                ++last;
+            }
+            const DiffRegion& firstRegion = regionList[r];
+            const DiffRegion& lastRegion = regionList[last];
+            size_t leading = std::min(context, firstRegion.oldStart);
+            size_t trailing = std::min(context, oldLineList.size() - (lastRegion.oldStart + lastRegion.oldCount));
+            size_t oldStart = firstRegion.oldStart - leading, newStart = firstRegion.newStart - leading;
+            size_t oldCount = lastRegion.oldStart + lastRegion.oldCount + trailing - oldStart;
+            size_t newCount = lastRegion.newStart + lastRegion.newCount + trailing - newStart;
+
+            out << "@@ -";
+            writeRange(out, oldStart, oldCount);
+            out << " +";
+            writeRange(out, newStart, newCount);
+            out << " @@\n";
+
+            size_t oldLine = oldStart;
+            for (size_t i = r; i <= last; ++i) {
+                const DiffRegion& region = regionList[i];
+                for (; oldLine < region.oldStart; ++oldLine) {
+                    writeLine(out, ' ', oldLineList[oldLine]);
+                }
+                for (size_t k = 0; k < region.oldCount; ++k) {
+                    writeLine(out, '-', oldLineList[region.oldStart + k]);
+                }
+                for (size_t k = 0; k < region.newCount; ++k) {
+                    writeLine(out, '+', newLineList[region.newStart + k]);
+                }
+                oldLine = region.oldStart + region.oldCount;
+            }
+            for (size_t k = 0; k < trailing; ++k) {
+                writeLine(out, ' ', oldLineList[oldLine + k]);
+            }
+            r = last + 1;
+        }
+    }
+
+private:
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+    static constexpr uint32_t kMaxChainLength = 64; // Histogram: lines more frequent than this are not anchors
+
+    std::vector<std::string_view> oldLineList, newLineList;
+    std::vector<char> oldChanged, newChanged;
+    std::vector<DiffRegion> regionList;
+
+    // Lines left after trimming, as content numbers (a and b) starting at line `offset`
+    size_t offset = 0;
+    std::vector<uint32_t> a, b;
+    uint32_t distinctLines = 0;
+
+    // Scratch tables indexed by content number (histogram and patience)
+    std::vector<uint32_t> countA, countB;
+    std::vector<size_t> firstPos, nextPos;
+
+    // Count the identical lines at the start and end of both texts. Bytes are compared in
+    // blocks with memcmp (vectorized by the C library); lines are only looked at where the
+    // texts first differ.
+    void trimCommonLines(std::string_view oldText, std::string_view newText, size_t& prefix, size_t& suffix) const {
+        constexpr size_t kBlock = 256;
+        size_t limit = std::min(oldText.size(), newText.size());
+
+        size_t equalBytes = 0;
+        while (equalBytes + kBlock <= limit &&
+               std::memcmp(oldText.data() + equalBytes, newText.data() + equalBytes, kBlock) == 0) {
+            equalBytes += kBlock;
+        }
+        while (equalBytes < limit && oldText[equalBytes] == newText[equalBytes]) {
+            ++equalBytes;
+        }
+        // A line is common if it lies inside the equal bytes on both sides
+        size_t end = 0;
+        prefix = 0;
+        while (prefix < oldLineList.size() && prefix < newLineList.size() &&
+               oldLineList[prefix].size() == newLineList[prefix].size() &&
+               end + oldLineList[prefix].size() <= equalBytes) {
+            end += oldLineList[prefix].size();
+            ++prefix;
+        }
+
+        limit -= end; // The suffix must not overlap the prefix
+        equalBytes = 0;
+        while (equalBytes + kBlock <= limit &&
+               std::memcmp(oldText.data() + oldText.size() - equalBytes - kBlock,
+                           newText.data() + newText.size() - equalBytes - kBlock, kBlock) == 0) {
+            equalBytes += kBlock;
+        }
+        while (equalBytes < limit && oldText[oldText.size() - equalBytes - 1] == newText[newText.size() - equalBytes - 1]) {
+            ++equalBytes;
+        }
+        end = 0;
+        suffix = 0;
+        while (prefix + suffix < oldLineList.size() && prefix + suffix < newLineList.size()) {
+            std::string_view oldLine = oldLineList[oldLineList.size() - suffix - 1];
+            std::string_view newLine = newLineList[newLineList.size() - suffix - 1];
+            if (oldLine.size() != newLine.size() || end + oldLine.size() > equalBytes) break;
+            end += oldLine.size();
+            ++suffix;
+        }
+    }
+
+    // Number the lines between the common prefix and suffix by content
+    void numberLines(size_t prefix, size_t oldEnd, size_t newEnd) {
+        offset = prefix;
+        std::unordered_map<std::string_view, uint32_t> numbers;
+        numbers.reserve(oldEnd - prefix + newEnd - prefix);
+        auto number = [&](std::string_view line) {
+            auto [it, inserted] = numbers.emplace(line, distinctLines);
+            if (inserted) ++distinctLines;
+            return it->second;
+        };
+        for (size_t i = prefix; i < oldEnd; ++i) a.push_back(number(oldLineList[i]));
+        for (size_t j = prefix; j < newEnd; ++j) b.push_back(number(newLineList[j]));
+    }
+
+    void markOld(size_t lo, size_t hi) { std::fill(oldChanged.begin() + offset + lo, oldChanged.begin() + offset + hi, 1); }
+    void markNew(size_t lo, size_t hi) { std::fill(newChanged.begin() + offset + lo, newChanged.begin() + offset + hi, 1); }
+
+    // Shrink a[aLo, aHi) and b[bLo, bHi) by their common first and last lines; returns
+    // true (after marking the rest) if one side became empty
+    bool trimRange(size_t& aLo, size_t& aHi, size_t& bLo, size_t& bHi) {
+        while (aLo < aHi && bLo < bHi && a[aLo] == b[bLo]) { ++aLo; ++bLo; }
+        while (aLo < aHi && bLo < bHi && a[aHi - 1] == b[bHi - 1]) { --aHi; --bHi; }
+        if (aLo == aHi || bLo == bHi) {
+            markOld(aLo, aHi);
+            markNew(bLo, bHi);
+            return true;
+        }
+        return false;
+    }
+
+    // Myers' O(ND) algorithm in linear space: find the middle snake of an optimal edit
+    // path by searching from both ends at once, then solve the two halves
+    void myers(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        if (trimRange(aLo, aHi, bLo, bHi)) {
+            return;
+        }
+        const long n = static_cast<long>(aHi - aLo), m = static_cast<long>(bHi - bLo);
+        const long delta = n - m;
+        const bool odd = delta & 1;
+        const long maxD = (n + m + 1) / 2;
+        const long vOffset = maxD + 1;
+        std::vector<long> forward(2 * maxD + 3, 0), backward(2 * maxD + 3, 0);
+        // Backward paths are forward paths over the reversed ranges
+        auto oldAt = [&](long x, bool reversed) { return a[reversed ? aHi - 1 - x : aLo + x]; };
+        auto newAt = [&](long y, bool reversed) { return b[reversed ? bHi - 1 - y : bLo + y]; };
+
+        long splitX = 0, splitY = 0;
+        bool found = false;
+        for (long d = 0; d <= maxD && !found; ++d) {
+            for (int pass = 0; pass < 2 && !found; ++pass) {
+                bool reversed = pass == 1;
+                std::vector<long>& v = reversed ? backward : forward;
+                const std::vector<long>& other = reversed ? forward : backward;
+                for (long k = -d; k <= d; k += 2) {
+                    long x = (k == -d || (k != d && v[vOffset + k - 1] < v[vOffset + k + 1]))
+                                 ? v[vOffset + k + 1]
+                                 : v[vOffset + k - 1] + 1;
+                    long y = x - k;
+                    while (x < n && y < m && oldAt(x, reversed) == newAt(y, reversed)) {
+                        ++x;
+                        ++y;
+                    }
+                    v[vOffset + k] = x;
+
+                    // Overlap with the opposite search (on diagonal delta - k in its
+                    // coordinates): forward checks after odd deltas, backward after even ones
+                    long otherK = delta - k;
+                    long otherD = reversed ? d : d - 1;
+                    if (odd != reversed && otherK >= -otherD && otherK <= otherD &&
+                        x + other[vOffset + otherK] >= n) {
+                        splitX = reversed ? n - x : x;
+                        splitY = reversed ? m - y : y;
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+        myers(aLo, aLo + splitX, bLo, bLo + splitY);
+        myers(aLo + splitX, aHi, bLo + splitY, bHi);
+    }
+
+    // Patience diff: match the lines that occur exactly once on each side, keep the
+    // longest run of such matches that is in order on both sides, and diff the gaps
+    // between them; ranges without unique common lines fall back to Myers
+    void patience(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        if (trimRange(aLo, aHi, bLo, bHi)) {
+            return;
+        }
+        prepareTables();
+        for (size_t i = aLo; i < aHi; ++i) {
+            if (countA[a[i]]++ == 0) firstPos[a[i]] = i;
+        }
+        for (size_t j = bLo; j < bHi; ++j) {
+            ++countB[b[j]];
+        }
+        // Unique common lines in new-side order, as old-side positions
+        std::vector<std::pair<size_t, size_t>> matches; // (old position, new position)
+        for (size_t j = bLo; j < bHi; ++j) {
+            uint32_t line = b[j];
+            if (countA[line] == 1 && countB[line] == 1) {
+                matches.emplace_back(firstPos[line], j);
+            }
+        }
+        for (size_t i = aLo; i < aHi; ++i) countA[a[i]] = 0;
+        for (size_t j = bLo; j < bHi; ++j) countB[b[j]] = 0;
+        if (matches.empty()) {
+            myers(aLo, aHi, bLo, bHi);
+            return;
+        }
+
+        // Longest increasing run of old positions (patience sorting with back links)
+        std::vector<size_t> pileTops;                        // Index into matches of each pile's top
+        std::vector<size_t> previous(matches.size(), kNone); // Top of the pile to the left when placed
+        for (size_t i = 0; i < matches.size(); ++i) {
+            auto pile = std::lower_bound(pileTops.begin(), pileTops.end(), matches[i].first,
+                                         [&](size_t top, size_t pos) { return matches[top].first < pos; });
+            if (pile != pileTops.begin()) previous[i] = *(pile - 1);
+            if (pile == pileTops.end()) pileTops.push_back(i);
+            else *pile = i;
+        }
+        std::vector<size_t> anchors;
+        for (size_t i = pileTops.back(); i != kNone; i = previous[i]) {
+            anchors.push_back(i);
+        }
+        std::reverse(anchors.begin(), anchors.end());
+
+        size_t oldPos = aLo, newPos = bLo;
+        for (size_t anchor : anchors) {
+            patience(oldPos, matches[anchor].first, newPos, matches[anchor].second);
+            oldPos = matches[anchor].first + 1;
+            newPos = matches[anchor].second + 1;
+        }
+        patience(oldPos, aHi, newPos, bHi);
+    }
+
+    // Histogram diff: find the common run of lines whose rarest line is least frequent
+    // on the old side (longest on ties), keep it, and diff what lies on either side of it.
+    // Ranges without a common line occurring at most kMaxChainLength times fall back to
+    // Myers. The smaller side is recursed into and the larger one continued in the loop,
+    // so the recursion depth stays logarithmic.
+    void histogram(size_t aLo, size_t aHi, size_t bLo, size_t bHi) {
+        while (!trimRange(aLo, aHi, bLo, bHi)) {
+            prepareTables();
+            for (size_t i = aHi; i-- > aLo;) {
+                uint32_t line = a[i];
+                nextPos[i] = countA[line]++ == 0 ? kNone : firstPos[line];
+                firstPos[line] = i;
+            }
+
+            size_t bestOld = 0, bestNew = 0, bestLength = 0;
+            uint32_t bestCount = kMaxChainLength + 1;
+            for (size_t j = bLo; j < bHi;) {
+                size_t nextJ = j + 1;
+                uint32_t count = countA[b[j]];
+                if (count > 0 && count <= kMaxChainLength) {
+                    for (size_t i = firstPos[b[j]]; i != kNone; i = nextPos[i]) {
+                        size_t oldStart = i, newStart = j, oldEnd = i + 1, newEnd = j + 1;
+                        while (oldStart > aLo && newStart > bLo && a[oldStart - 1] == b[newStart - 1]) {
+                            --oldStart;
+                            --newStart;
+                        }
+                        while (oldEnd < aHi && newEnd < bHi && a[oldEnd] == b[newEnd]) {
+                            ++oldEnd;
+                            ++newEnd;
+                        }
+                        uint32_t rarest = count;
+                        for (size_t k = oldStart; k < oldEnd; ++k) {
+                            rarest = std::min(rarest, countA[a[k]]);
+                        }
+                        if (rarest < bestCount || (rarest == bestCount && oldEnd - oldStart > bestLength)) {
+                            bestOld = oldStart;
+                            bestNew = newStart;
+                            bestLength = oldEnd - oldStart;
+                            bestCount = rarest;
+                        }
+                        nextJ = std::max(nextJ, newEnd);
+                    }
+                }
+                j = nextJ;
+            }
+            for (size_t i = aLo; i < aHi; ++i) countA[a[i]] = 0;
+
+            if (bestLength == 0) {
+                myers(aLo, aHi, bLo, bHi);
+                return;
+            }
+            size_t oldAfter = bestOld + bestLength, newAfter = bestNew + bestLength;
+            if ((bestOld - aLo) + (bestNew - bLo) <= (aHi - oldAfter) + (bHi - newAfter)) {
+                histogram(aLo, bestOld, bLo, bestNew);
+                aLo = oldAfter;
+                bLo = newAfter;
+            } else {
+                histogram(oldAfter, aHi, newAfter, bHi);
+                aHi = bestOld;
+                bHi = bestNew;
+            }
+        }
+    }
+
+    void prepareTables() {
+        if (countA.empty()) {
+            countA.assign(distinctLines, 0);
+            countB.assign(distinctLines, 0);
+            firstPos.assign(distinctLines, kNone);
+            nextPos.assign(a.size(), kNone);
+        }
+    }
+
+    // Turn the per-line marks into regions. Unchanged lines pair up in order on both sides.
+    void collectRegions() {
+        size_t i = 0, j = 0;
+        while (i < oldLineList.size() || j < newLineList.size()) {
+            bool oldLineChanged = i < oldLineList.size() && oldChanged[i];
+            bool newLineChanged = j < newLineList.size() && newChanged[j];
+            if (!oldLineChanged && !newLineChanged) {
+                ++i;
+                ++j;
+                continue;
+            }
+            DiffRegion region{i, 0, j, 0};
+            while (i < oldLineList.size() && oldChanged[i]) ++i;
+            while (j < newLineList.size() && newChanged[j]) ++j;
+            region.oldCount = i - region.oldStart;
+            region.newCount = j - region.newStart;
+            regionList.push_back(region);
+        }
+    }
+
+    // Hunk header range: 1-based start line and count (",1" is left out, and an empty
+    // range names the line before it)
+    static void writeRange(OutputBuffer& out, size_t start, size_t count) {
+        out << (count == 0 ? start : start + 1);
+        if (count != 1) {
+            out << ',' << count;
+        }
+    }
+
+    static void writeLine(OutputBuffer& out, char marker, std::string_view line) {
+        out << marker << line;
+        if (line.empty() || line.back() != '\n') {
+            out << "\n\\ No newline at end of file\n";
+        }
+    }
+};
+
+#endif // LINEDIFF_H
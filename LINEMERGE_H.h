@@ -0,0 +1,143 @@
+#ifndef LINEMERGE_H
+#define LINEMERGE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include "LINEDIFF_H.h"
+
+// Outcome of a three-way line merge
+struct LineMergeResult {
+    std::string text;     // Merged content, with conflict markers around unresolved regions
+    size_t conflicts = 0; // Number of conflict regions in text
+};
+
+// Which side wins regions both sides changed differently (merge -X ours / -X theirs)
+enum class MergeFavor {
+    None,   // Leave conflict markers
+    Ours,
+    Theirs
+};
+
+// This class merges two versions of a text that both descend from a common base
+// (diff3). Both sides are diffed against the base, and their changed regions are laid out
+// on the base's line numbers. Regions of the two sides that overlap or touch form one
+// chunk: a chunk changed by one side only takes that side's lines, a chunk both sides
+// changed the same way is taken once, and anything else becomes a conflict. Lines that
+// open or close both versions of a conflict are moved outside its markers, so only the
+// lines that really differ are left for the user, unless a side is favored: then that
+// side's lines are taken and no conflict is reported.
+class LineMerge {
+public:
+    static LineMergeResult merge(std::string_view base, std::string_view ours, std::string_view theirs,
+                                 const std::string& oursLabel, const std::string& theirsLabel,
+                                 MergeFavor favor = MergeFavor::None, DiffAlgorithm algorithm = DiffAlgorithm::Myers) {
+        LineDiff oursDiff(base, ours, algorithm);
+        LineDiff theirsDiff(base, theirs, algorithm);
+        const std::vector<std::string_view>& baseLines = oursDiff.oldLines();
+        const std::vector<DiffRegion>& oursRegions = oursDiff.regions();
+        const std::vector<DiffRegion>& theirsRegions = theirsDiff.regions();
+
+        LineMergeResult result;
+        result.text.reserve(std::max(ours.size(), theirs.size()));
+        size_t baseLine = 0;       // Next base line to copy
+        size_t o = 0, t = 0;       // Next region of each side
+        long oursShift = 0, theirsShift = 0; // Lines added minus lines removed by earlier regions
+        while (o < oursRegions.size() || t < theirsRegions.size()) {
+            // Start a chunk at the earlier region and absorb every region touching it
+            size_t chunkStart = std::min(o < oursRegions.size() ? oursRegions[o].oldStart : baseLines.size(),
+                                         t < theirsRegions.size() ? theirsRegions[t].oldStart : baseLines.size());
+            size_t chunkEnd = chunkStart;
+            size_t oursFirst = o, theirsFirst = t;
+            long oursDelta = 0, theirsDelta = 0;
+            while (true) {
+                if (o < oursRegions.size() && oursRegions[o].oldStart <= chunkEnd) {
+                    chunkEnd = std::max(chunkEnd, oursRegions[o].oldStart + oursRegions[o].oldCount);
+                    oursDelta += static_cast<long>(oursRegions[o].newCount) - static_cast<long>(oursRegions[o].oldCount);
+                    ++o;
+                } else if (t < theirsRegions.size() && theirsRegions[t].oldStart <= chunkEnd) {
+                    chunkEnd = std::max(chunkEnd, theirsRegions[t].oldStart + theirsRegions[t].oldCount);
+                    theirsDelta += static_cast<long>(theirsRegions[t].newCount) - static_cast<long>(theirsRegions[t].oldCount);
+                    ++t;
+                } else {
+                    break;
+                }
+            }
+
+            // Lines before the chunk are unchanged on both sides
+            for (; baseLine < chunkStart; ++baseLine) {
+                result.text.append(baseLines[baseLine]);
+            }
+            baseLine = chunkEnd;
+
+            // The chunk as each side has it (unchanged base lines inside it included)
+            size_t oursStart = chunkStart + oursShift, oursEnd = chunkEnd + oursShift + oursDelta;
+            size_t theirsStart = chunkStart + theirsShift, theirsEnd = chunkEnd + theirsShift + theirsDelta;
+            oursShift += oursDelta;
+            theirsShift += theirsDelta;
+            bool oursChanged = o > oursFirst, theirsChanged = t > theirsFirst;
+            if (!theirsChanged) {
+                appendLines(result.text, oursDiff.newLines(), oursStart, oursEnd);
+            } else if (!oursChanged) {
+                appendLines(result.text, theirsDiff.newLines(), theirsStart, theirsEnd);
+            } else {
+                appendConflict(result, oursDiff.newLines(), oursStart, oursEnd,
+                               theirsDiff.newLines(), theirsStart, theirsEnd, oursLabel, theirsLabel, favor);
+            }
+        }
+        for (; baseLine < baseLines.size(); ++baseLine) {
+            result.text.append(baseLines[baseLine]);
+        }
+        return result;
+    }
+
+private:
+    static void appendLines(std::string& text, const std::vector<std::string_view>& lines, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            text.append(lines[i]);
+        }
+    }
+
+    // Append a chunk both sides changed: identical edits are taken once, otherwise the
+    // common leading and trailing lines go outside the conflict markers
+    static void appendConflict(LineMergeResult& result,
+                               const std::vector<std::string_view>& oursLines, size_t oursStart, size_t oursEnd,
+                               const std::vector<std::string_view>& theirsLines, size_t theirsStart, size_t theirsEnd,
+                               const std::string& oursLabel, const std::string& theirsLabel, MergeFavor favor) {
+        while (oursStart < oursEnd && theirsStart < theirsEnd && oursLines[oursStart] == theirsLines[theirsStart]) {
+            result.text.append(oursLines[oursStart]);
+            ++oursStart;
+            ++theirsStart;
+        }
+        size_t commonEnd = 0;
+        while (oursStart + commonEnd < oursEnd && theirsStart + commonEnd < theirsEnd &&
+               oursLines[oursEnd - commonEnd - 1] == theirsLines[theirsEnd - commonEnd - 1]) {
+            ++commonEnd;
+        }
+        if (favor == MergeFavor::Ours) {
+            appendLines(result.text, oursLines, oursStart, oursEnd - commonEnd);
+        } else if (favor == MergeFavor::Theirs) {
+            appendLines(result.text, theirsLines, theirsStart, theirsEnd - commonEnd);
+        } else if (oursStart + commonEnd < oursEnd || theirsStart + commonEnd < theirsEnd) {
+            ++result.conflicts;
+            result.text.append("<<<<<<< " + oursLabel + "\n");
+            appendLines(result.text, oursLines, oursStart, oursEnd - commonEnd);
+            endLine(result.text);
+            result.text.append("=======\n");
+            appendLines(result.text, theirsLines, theirsStart, theirsEnd - commonEnd);
+            endLine(result.text);
+            result.text.append(">>>>>>> " + theirsLabel + "\n");
+        }
+        appendLines(result.text, oursLines, oursEnd - commonEnd, oursEnd);
+    }
+
+    // Markers must start on a line of their own, even after a last line without '\n'
+    static void endLine(std::string& text) {
+        if (!text.empty() && text.back() != '\n') {
+            text.push_back('\n');
+        }
+    }
+};
+
+#endif // LINEMERGE_H
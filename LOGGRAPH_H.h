@@ -0,0 +1,144 @@
+#ifndef LOGGRAPH_H
+#define LOGGRAPH_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "COMMITGRAPH_H.h"
+
+// This class draws the ASCII history graph for `log --graph`, one commit at a time as
+// the commits stream out of the revision walker. The only state is one lane per line of
+// history currently on screen, holding the commit that line is waiting for, so memory is
+// proportional to the width of the graph rather than the length of the history.
+//
+// Commits must arrive children first (topological order); a commit nobody is waiting
+// for yet (a branch tip) opens a new lane on the right.
+class LogGraph {
+public:
+    // Prefix of the first output line of a commit, e.g. "| * | "
+    std::string commitLine(CommitNode node) {
+        auto it = std::find(lanes.begin(), lanes.end(), node);
+        if (it == lanes.end()) {
+            lanes.push_back(node);
+            it = lanes.end() - 1;
+        }
+        column = static_cast<size_t>(it - lanes.begin());
+
+        std::string line(lanes.size() * 2, ' ');
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            line[i * 2] = i == column ? '*' : '|';
+        }
+        return line;
+    }
+
+    // Prefix of the remaining output lines of the current commit, e.g. "| | | "
+    std::string padding() const {
+        std::string line(lanes.size() * 2, ' ');
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            line[i * 2] = '|';
+        }
+        return line;
+    }
+
+    // Move past the current commit: its lane now waits for its first parent, further
+    // parents open lanes to its right, and a lane waiting for a commit that another lane
+    // already waits for is folded into it. Returns the connecting rows to print (if any).
+    std::string advance(const std::vector<CommitNode>& parents) {
+        std::string rows;
+        if (parents.empty()) {
+            // Root commit: its line of history ends and the lanes to its right move left
+            lanes.erase(lanes.begin() + column);
+            if (column < lanes.size()) {
+                rows += shiftLeftRow(column, lanes.size() + 1, kNoJoin);
+            }
+            return rows;
+        }
+
+        lanes[column] = parents[0];
+        size_t added = 0;
+        for (size_t i = 1; i < parents.size(); ++i) {
+            if (std::find(lanes.begin(), lanes.end(), parents[i]) == lanes.end()) {
+                lanes.insert(lanes.begin() + column + 1 + added, parents[i]);
+                ++added;
+            }
+        }
+        // One "|\" row per new lane, so an octopus merge fans out a lane at a time
+        for (size_t i = 0; i < added; ++i) {
+            rows += branchRow(lanes.size() - added + i);
+        }
+
+        // Two lanes waiting for the same commit join; the one further right goes away. It
+        // steps one column left per row, crossing the lanes in between, until it meets the
+        // lane it joins, so it is never drawn as joining a lane it only passes.
+        for (size_t k = 0; k < lanes.size(); ++k) {
+            if (k != column && lanes[k] == parents[0]) {
+                size_t removed = std::max(k, column);
+                size_t target = std::min(k, column);
+                for (size_t at = removed; at > target + 1; --at) {
+                    rows += crossRow(removed, at);
+                }
+                rows += shiftLeftRow(removed, lanes.size(), target + 1);
+                lanes.erase(lanes.begin() + removed);
+                break;
+            }
+        }
+        return rows;
+    }
+
+    // Move past a commit that is not shown (e.g. filtered out by path) without drawing
+    // anything, so the lane waiting for it continues to its parents
+    void skip(CommitNode node, const std::vector<CommitNode>& parents) {
+        commitLine(node);
+        advance(parents);
+    }
+
+private:
+    static constexpr size_t kNoJoin = SIZE_MAX;
+
+    std::vector<CommitNode> lanes; // The commit each lane is waiting for, left to right
+    size_t column = 0;             // Lane of the commit being printed
+
+    // Row below a merge: "|\" at the merge's lane, lanes to its right shift right
+    std::string branchRow(size_t oldWidth) const {
+        std::string row(oldWidth * 2 + 1, ' ');
+        for (size_t i = 0; i < oldWidth; ++i) {
+            if (i <= column) row[i * 2] = '|';
+            if (i >= column) row[i * 2 + 1] = '\\';
+        }
+        return trimmed(row);
+    }
+
+    // Row where lane `removed` ends, with "/" left of column joinFrom if the lane, by now
+    // at that column, joins the lane on its left (kNoJoin if it just ends); lanes to its
+    // right shift left
+    std::string shiftLeftRow(size_t removed, size_t oldWidth, size_t joinFrom) const {
+        std::string row(oldWidth * 2, ' ');
+        for (size_t i = 0; i < oldWidth; ++i) {
+            if (i < removed) row[i * 2] = '|';
+            else if (i > removed) row[i * 2 - 1] = '/';
+        }
+        if (joinFrom != kNoJoin) {
+            row[joinFrom * 2 - 1] = '/';
+        }
+        return trimmed(row);
+    }
+
+    // Row where lane `removed`, on its way left to join another lane, crosses from column
+    // `at` to the one before it; every other lane goes straight down
+    std::string crossRow(size_t removed, size_t at) const {
+        std::string row(lanes.size() * 2, ' ');
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            if (i != removed) row[i * 2] = '|';
+        }
+        row[at * 2 - 1] = '/';
+        return trimmed(row);
+    }
+
+    static std::string trimmed(std::string row) {
+        row.erase(row.find_last_not_of(' ') + 1);
+        return row + "\n";
+    }
+};
+
+#endif // LOGGRAPH_H
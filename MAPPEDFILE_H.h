@@ -0,0 +1,83 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <filesystem>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// This class maps a file read-only into memory. Index files such as the commit-graph
+// are accessed through it so that lookups touch only the pages they need instead of
+// reading and parsing the whole file up front. On platforms without mmap the file is
+// read into a buffer instead.
+class MappedFile {
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    std::string buffer;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Map the file; returns false if it does not exist or cannot be read
+    bool open(const std::filesystem::path& filepath) {
+        close();
+#ifdef _WIN32
+        std::ifstream inFile(filepath, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+        buffer.assign((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+        mappedData = buffer.data();
+        mappedSize = buffer.size();
+        return true;
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping stays valid after the descriptor is closed
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        mappedData = static_cast<const char*>(address);
+        mappedSize = static_cast<size_t>(st.st_size);
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (mappedData) {
+            munmap(const_cast<char*>(mappedData), mappedSize);
+        }
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool isOpen() const { return mappedData != nullptr; }
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,58 @@
+#ifndef OBJECTID_H
+#define OBJECTID_H
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+// This class stores an object hash inline in a fixed-width, NUL-padded buffer, so that
+// containers of object ids are contiguous and compare with a single memcmp. The byte
+// order matches std::string comparison of the hash text.
+class ObjectId {
+public:
+    static constexpr size_t kWidth = 40; // Enough for any computeHash() result (and SHA-1 hex)
+
+    ObjectId() { bytes.fill('\0'); }
+
+    explicit ObjectId(std::string_view hash) {
+        bytes.fill('\0');
+        std::memcpy(bytes.data(), hash.data(), std::min(hash.size(), kWidth));
+    }
+
+    // Convert back to the textual hash used for object file names
+    std::string toString() const {
+        return std::string(bytes.data(), size());
+    }
+
+    // Number of meaningful characters
+    size_t size() const {
+        const void* nul = std::memchr(bytes.data(), '\0', kWidth);
+        return nul ? static_cast<const char*>(nul) - bytes.data() : kWidth;
+    }
+
+    // A null id stands for "no object" (e.g. a file missing on one side of a comparison)
+    bool isNull() const { return bytes[0] == '\0'; }
+
+    const char* data() const { return bytes.data(); }
+
+    bool operator==(const ObjectId& other) const { return std::memcmp(bytes.data(), other.bytes.data(), kWidth) == 0; }
+    bool operator!=(const ObjectId& other) const { return !(*this == other); }
+    bool operator<(const ObjectId& other) const { return std::memcmp(bytes.data(), other.bytes.data(), kWidth) < 0; }
+
+private:
+    std::array<char, kWidth> bytes;
+};
+
+namespace std {
+    template <>
+    struct hash<ObjectId> {
+        size_t operator()(const ObjectId& id) const {
+            return std::hash<std::string_view>()(std::string_view(id.data(), id.size()));
+        }
+    };
+}
+
+#endif // OBJECTID_H
@@ -0,0 +1,54 @@
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <type_traits>
+
+// This class collects command output in memory and hands it to the stream in large
+// blocks. Commands that print one line per commit or per file use it instead of
+// writing (and flushing with std::endl) line by line.
+class OutputBuffer {
+private:
+    static constexpr size_t kFlushSize = 64 * 1024;
+
+    std::ostream& out;
+    std::string buffer;
+
+public:
+    explicit OutputBuffer(std::ostream& stream = std::cout) : out(stream) {
+        buffer.reserve(kFlushSize);
+    }
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer& operator<<(std::string_view text) {
+        buffer.append(text.data(), text.size());
+        if (buffer.size() >= kFlushSize) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+        return *this;
+    }
+
+    OutputBuffer& operator<<(char c) {
+        return *this << std::string_view(&c, 1);
+    }
+
+    // Numbers are formatted like std::ostream does
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    OutputBuffer& operator<<(T value) {
+        return *this << std::string_view(std::to_string(value));
+    }
+
+    // Write everything buffered so far to the stream
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+        out.flush();
+    }
+};
+
+#endif // OUTPUTBUFFER_H
@@ -0,0 +1,93 @@
+#ifndef PATHPOOL_H
+#define PATHPOOL_H
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <cstring>
+#include <algorithm>
+
+// This class interns file paths into a chunked arena. Every distinct path is stored
+// exactly once and handed out as a std::string_view that stays valid for the lifetime
+// of the pool (chunks are never moved or freed). HEAD, index and working directory
+// snapshots all draw from the same pool, so a path present in all three costs one copy
+// instead of three heap-allocated std::strings.
+//
+// Child paths are built directly in the arena from an interned directory handle and a
+// file name (see join), so walking a tree or the working directory does not allocate a
+// temporary string per file.
+class PathPool {
+private:
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t chunkUsed = kChunkSize;     // Bytes used in the last chunk (full => allocate)
+    size_t chunkCapacity = kChunkSize; // Capacity of the last chunk
+    std::unordered_set<std::string_view> interned;
+
+    // Reserve space for `size` bytes at the end of the arena
+    char* reserve(size_t size) {
+        if (chunkUsed + size > chunkCapacity) {
+            chunkCapacity = std::max(kChunkSize, size);
+            chunks.emplace_back(new char[chunkCapacity]);
+            chunkUsed = 0;
+        }
+        return chunks.back().get() + chunkUsed;
+    }
+
+    // Finish interning the `size` bytes just written at `data` (from reserve())
+    std::string_view commit(const char* data, size_t size) {
+        std::string_view candidate(data, size);
+        auto it = interned.find(candidate);
+        if (it != interned.end()) {
+            return *it; // Already interned: the scratch bytes are simply reused next time
+        }
+        chunkUsed += size;
+        interned.insert(candidate);
+        return candidate;
+    }
+
+public:
+    PathPool() = default;
+    PathPool(const PathPool&) = delete;
+    PathPool& operator=(const PathPool&) = delete;
+
+    // The process-wide pool used by snapshots, the index and the scanner
+    static PathPool& global() {
+        static PathPool pool;
+        return pool;
+    }
+
+    // Intern a path and return its stable handle
+    std::string_view intern(std::string_view path) {
+        if (path.empty()) {
+            return std::string_view();
+        }
+        auto it = interned.find(path);
+        if (it != interned.end()) {
+            return *it;
+        }
+        char* data = reserve(path.size());
+        std::memcpy(data, path.data(), path.size());
+        return commit(data, path.size());
+    }
+
+    // Intern "directory/name" (or just "name" for the root directory "")
+    std::string_view join(std::string_view directory, std::string_view name) {
+        if (directory.empty()) {
+            return intern(name);
+        }
+        size_t size = directory.size() + 1 + name.size();
+        char* data = reserve(size);
+        std::memcpy(data, directory.data(), directory.size());
+        data[directory.size()] = '/';
+        std::memcpy(data + directory.size() + 1, name.data(), name.size());
+        return commit(data, size);
+    }
+
+    // Number of distinct paths interned so far
+    size_t size() const { return interned.size(); }
+};
+
+#endif // PATHPOOL_H
@@ -0,0 +1,279 @@
+#ifndef RENAMES_H
+#define RENAMES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include "Utils.h"
+#include "LINEDIFF_H.h"
+#include "TREEDIFF_H.h"
+#include "BINARY_H.h"
+
+// A file that was moved (or copied) between two versions of the tree
+struct RenamePair {
+    std::string oldPath;
+    std::string newPath;
+    std::string oldHash;
+    std::string newHash;
+    int similarity; // Percentage of lines the two versions have in common (100 for an exact match)
+    bool copy;      // The old path still exists, so the new file is a copy rather than a move
+};
+
+// This class pairs files that disappeared from a change list with files that appeared,
+// so a move shows up as one rename instead of a deletion and an unrelated addition.
+//
+// Exact moves are paired first by blob hash alone, without reading any content. The
+// remaining files are compared by content: each is reduced to the multiset of its line
+// hashes and a MinHash sketch of that set (kSketchSize minimum hash values, one per hash
+// function). Sketches are cut into bands, and only files sharing at least one band are
+// compared exactly, so the work grows with the number of files rather than with the number
+// of possible pairs. Similarity is the share of lines the two versions have in common,
+// relative to the longer one. The most similar pairs are taken first; every added file gets
+// at most one source, and every deleted file is moved at most once. Binary files have no
+// lines to compare, so they are only paired by exact moves.
+class RenameDetector {
+public:
+    // Reads the content of one side of a change
+    using ContentReader = std::function<std::string(const std::string& path, const std::string& hash)>;
+
+    static constexpr int kDefaultMinSimilarity = 50;
+
+    // Find renames among the deleted and added files of a change list. With findCopies,
+    // modified files (and deleted files already used by a rename) may also be the source
+    // of an added file, which is then reported as a copy. The result is sorted by new path.
+    static std::vector<RenamePair> detect(const std::vector<TreeChange>& changes,
+                                          const ContentReader& readOld, const ContentReader& readNew,
+                                          int minSimilarity = kDefaultMinSimilarity, bool findCopies = false) {
+        std::vector<const TreeChange*> sources, targets;
+        for (const auto& change : changes) {
+            if (change.status == 'A') {
+                targets.push_back(&change);
+            } else if (change.status == 'D' || (findCopies && change.status == 'M')) {
+                sources.push_back(&change);
+            }
+        }
+        std::vector<RenamePair> renames;
+        if (sources.empty() || targets.empty()) {
+            return renames;
+        }
+
+        std::vector<bool> sourceMoved(sources.size(), false); // Deleted source used by a rename
+        std::vector<bool> targetPaired(targets.size(), false);
+        auto addPair = [&](size_t s, size_t t, int similarity) {
+            bool copy = sources[s]->status != 'D' || sourceMoved[s];
+            if (!copy) {
+                sourceMoved[s] = true;
+            }
+            targetPaired[t] = true;
+            renames.push_back({sources[s]->path, targets[t]->path, sources[s]->oldHash, targets[t]->newHash, similarity, copy});
+        };
+        auto usable = [&](size_t s) { return findCopies || (sources[s]->status == 'D' && !sourceMoved[s]); };
+
+        // 1. Exact moves: same blob on both sides. Empty files are all alike, so they are
+        // not paired at all.
+        const std::string emptyHash = Utils::computeHash("");
+        std::unordered_map<std::string_view, std::vector<size_t>> sourcesByHash;
+        for (size_t s = 0; s < sources.size(); ++s) {
+            if (sources[s]->oldHash != emptyHash) {
+                sourcesByHash[sources[s]->oldHash].push_back(s);
+            }
+        }
+        for (size_t t = 0; t < targets.size(); ++t) {
+            auto it = sourcesByHash.find(targets[t]->newHash);
+            if (it == sourcesByHash.end()) continue;
+            size_t best = sources.size();
+            for (size_t s : it->second) {
+                if (!usable(s)) continue;
+                if (best == sources.size() || betterSource(*sources[s], *sources[best], sourceMoved[s], sourceMoved[best], *targets[t])) {
+                    best = s;
+                }
+            }
+            if (best != sources.size()) {
+                addPair(best, t, 100);
+            }
+        }
+
+        // 2. Similar content, for whatever is left
+        std::vector<size_t> openSources, openTargets;
+        for (size_t s = 0; s < sources.size(); ++s) {
+            if (usable(s)) openSources.push_back(s);
+        }
+        for (size_t t = 0; t < targets.size(); ++t) {
+            if (!targetPaired[t]) openTargets.push_back(t);
+        }
+        if (!openSources.empty() && !openTargets.empty()) {
+            std::vector<Candidate> candidates = findSimilar(sources, openSources, targets, openTargets,
+                                                            readOld, readNew, minSimilarity);
+            std::sort(candidates.begin(), candidates.end(), [&](const Candidate& a, const Candidate& b) {
+                if (a.similarity != b.similarity) return a.similarity > b.similarity;
+                bool aSameName = baseName(sources[a.source]->path) == baseName(targets[a.target]->path);
+                bool bSameName = baseName(sources[b.source]->path) == baseName(targets[b.target]->path);
+                if (aSameName != bSameName) return aSameName;
+                if (a.target != b.target) return a.target < b.target;
+                return a.source < b.source;
+            });
+            for (const auto& candidate : candidates) {
+                if (!targetPaired[candidate.target] && usable(candidate.source)) {
+                    addPair(candidate.source, candidate.target, candidate.similarity);
+                }
+            }
+        }
+
+        std::sort(renames.begin(), renames.end(),
+                  [](const RenamePair& a, const RenamePair& b) { return a.newPath < b.newPath; });
+        return renames;
+    }
+
+private:
+    static constexpr size_t kSketchSize = 64;    // MinHash values per file
+    static constexpr size_t kRowsPerBand = 2;    // Values hashed together into one LSH bucket key
+    static constexpr size_t kMaxBucketSize = 64; // Larger buckets (shared boilerplate) are not used
+
+    struct Candidate {
+        size_t source;
+        size_t target;
+        int similarity;
+    };
+
+    // A file's content reduced to what comparisons need
+    struct Fingerprint {
+        std::vector<uint64_t> lines;  // Sorted hashes of all lines (a multiset)
+        std::vector<uint64_t> sketch; // MinHash sketch of the distinct lines; empty for an empty file
+    };
+
+    static uint64_t mix(uint64_t x) { // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static uint64_t hashLine(std::string_view line) { // FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : line) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static std::string_view baseName(std::string_view path) {
+        size_t slash = path.rfind('/');
+        return slash == std::string_view::npos ? path : path.substr(slash + 1);
+    }
+
+    // Among sources with the same blob, prefer one not yet moved, then one with the
+    // target's file name, then the first in path order
+    static bool betterSource(const TreeChange& candidate, const TreeChange& best,
+                             bool candidateMoved, bool bestMoved, const TreeChange& target) {
+        bool candidateMove = candidate.status == 'D' && !candidateMoved;
+        bool bestMove = best.status == 'D' && !bestMoved;
+        if (candidateMove != bestMove) return candidateMove;
+        bool candidateSameName = baseName(candidate.path) == baseName(target.path);
+        bool bestSameName = baseName(best.path) == baseName(target.path);
+        return candidateSameName && !bestSameName;
+    }
+
+    static Fingerprint fingerprint(const std::string& content) {
+        Fingerprint result;
+        if (BinaryDetector::isBinary(content)) {
+            return result; // No sketch: never compared
+        }
+        for (std::string_view line : LineDiff::splitLines(content)) {
+            result.lines.push_back(hashLine(line));
+        }
+        std::sort(result.lines.begin(), result.lines.end());
+        if (result.lines.empty()) {
+            return result;
+        }
+        static const std::vector<uint64_t> seeds = [] {
+            std::vector<uint64_t> values(kSketchSize);
+            for (size_t k = 0; k < kSketchSize; ++k) {
+                values[k] = mix((k + 1) * 0x9e3779b97f4a7c15ULL);
+            }
+            return values;
+        }();
+        result.sketch.assign(kSketchSize, UINT64_MAX);
+        for (size_t i = 0; i < result.lines.size(); ++i) {
+            if (i > 0 && result.lines[i] == result.lines[i - 1]) continue; // Sketch the set of distinct lines
+            for (size_t k = 0; k < kSketchSize; ++k) {
+                result.sketch[k] = std::min(result.sketch[k], mix(result.lines[i] ^ seeds[k]));
+            }
+        }
+        return result;
+    }
+
+    // Share of lines two files have in common, in percent of the longer file
+    static int commonLinePercent(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+        size_t common = 0;
+        for (size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+            if (a[i] < b[j]) {
+                ++i;
+            } else if (b[j] < a[i]) {
+                ++j;
+            } else {
+                ++common;
+                ++i;
+                ++j;
+            }
+        }
+        return static_cast<int>(common * 100 / std::max(a.size(), b.size()));
+    }
+
+    // Compare the open targets with the open sources whose sketches share a band with them
+    static std::vector<Candidate> findSimilar(const std::vector<const TreeChange*>& sources, const std::vector<size_t>& openSources,
+                                              const std::vector<const TreeChange*>& targets, const std::vector<size_t>& openTargets,
+                                              const ContentReader& readOld, const ContentReader& readNew, int minSimilarity) {
+        std::vector<Fingerprint> sourcePrints(openSources.size());
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets; // Band key -> positions in openSources
+        for (size_t i = 0; i < openSources.size(); ++i) {
+            const TreeChange& source = *sources[openSources[i]];
+            sourcePrints[i] = fingerprint(readOld(source.path, source.oldHash));
+            if (sourcePrints[i].sketch.empty()) continue;
+            for (size_t band = 0; band < kSketchSize / kRowsPerBand; ++band) {
+                buckets[bandKey(sourcePrints[i].sketch, band)].push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        std::vector<Candidate> candidates;
+        std::vector<size_t> lastSeen(openSources.size(), SIZE_MAX); // Target that last compared each source
+        for (size_t j = 0; j < openTargets.size(); ++j) {
+            const TreeChange& target = *targets[openTargets[j]];
+            Fingerprint targetPrint = fingerprint(readNew(target.path, target.newHash));
+            if (targetPrint.sketch.empty()) continue;
+            for (size_t band = 0; band < kSketchSize / kRowsPerBand; ++band) {
+                auto it = buckets.find(bandKey(targetPrint.sketch, band));
+                if (it == buckets.end() || it->second.size() > kMaxBucketSize) continue;
+                for (uint32_t i : it->second) {
+                    if (lastSeen[i] == j) continue;
+                    lastSeen[i] = j;
+                    const std::vector<uint64_t>& sourceLines = sourcePrints[i].lines;
+                    // The shorter file bounds the similarity; skip pairs that cannot reach the threshold
+                    size_t shorter = std::min(sourceLines.size(), targetPrint.lines.size());
+                    size_t longer = std::max(sourceLines.size(), targetPrint.lines.size());
+                    if (shorter * 100 < static_cast<size_t>(minSimilarity) * longer) continue;
+                    int score = commonLinePercent(sourceLines, targetPrint.lines);
+                    if (score >= minSimilarity) {
+                        candidates.push_back({openSources[i], openTargets[j], score});
+                    }
+                }
+            }
+        }
+        return candidates;
+    }
+
+    static uint64_t bandKey(const std::vector<uint64_t>& sketch, size_t band) {
+        uint64_t key = mix(band + 1);
+        for (size_t k = band * kRowsPerBand; k < (band + 1) * kRowsPerBand; ++k) {
+            key = mix(key ^ sketch[k]);
+        }
+        return key;
+    }
+};
+
+#endif // RENAMES_H
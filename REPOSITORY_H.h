@@ -9,24 +9,71 @@
 #include <sstream>
 #include <queue>
 #include <set>
+#include <unordered_set>
 #include <memory> // For std::unique_ptr
 #include <algorithm> // For std::set_union, etc.
+#include <cstring>   // For strlen
+#include <limits>
 
 #include "Utils.h" // Your comprehensive utility functions
 #include "BLOB_H.h" // Corrected from "Blob.h"
 #include "COMMIT_H.h" // Corrected from "Commit.h"
+#include "COMMITGRAPH_H.h"
+#include "REVWALK_H.h"
+#include "REVPARSE_H.h"
+#include "LOGGRAPH_H.h"
+#include "LINEDIFF_H.h"
+#include "OUTPUTBUFFER_H.h"
+#include "TREEDIFF_H.h"
+#include "RENAMES_H.h"
+#include "TREEMERGE_H.h"
+#include "SNAPSHOT_H.h"
+#include "WORKTREE_H.h"
 #include "STAGINGAREA_H.h" // Corrected from "StagingArea.h"
 
+// Options for Repository::log
+struct LogOptions {
+    size_t maxCount = static_cast<size_t>(-1); // -n: stop after this many commits
+    bool all = false;         // --all: start from every branch as well as HEAD
+    bool topoOrder = false;   // --topo-order: never show a commit before its children
+    bool firstParent = false; // --first-parent: follow only the first parent of merges
+    bool oneline = false;     // --oneline: one "<short hash> <subject>" line per commit
+    bool drawGraph = false;   // --graph: draw the history graph next to the commits
+    std::string path;         // -- <path>: only commits that changed this file or directory
+    int64_t since = std::numeric_limits<int64_t>::min(); // --since: no commits older than this
+    int64_t until = std::numeric_limits<int64_t>::max(); // --until: no commits newer than this
+    std::vector<std::string> revisions; // e.g. "master", "HEAD~3", "A..B" (HEAD if none given)
+};
+
+// Options for Repository::diff
+struct DiffOptions {
+    bool cached = false;     // --cached: compare the index with HEAD instead of the working directory with the index
+    bool nameStatus = false; // --name-status: only list the changed files
+    DiffAlgorithm algorithm = DiffAlgorithm::Myers; // --patience, --histogram
+    size_t context = 3;      // -U<n>: unchanged lines shown around each change
+    bool findRenames = true; // --no-renames: show moved files as a deletion and an addition
+    bool findCopies = false; // -C: also report added files copied from modified or deleted ones
+    int renameThreshold = RenameDetector::kDefaultMinSimilarity; // -M<n>: minimum similarity in percent
+    std::vector<std::string> revisions; // Two commits, or a range such as "A..B"
+};
+
 class Repository {
 private:
+    // Commits in a row older than --since that log looks at before it stops (git's "slop"),
+    // so a single commit with a skewed clock does not hide the older commits after it
+    static constexpr int kSinceSlop = 5;
+
     std::filesystem::path workingDir;
     std::filesystem::path minigitDir;
     std::filesystem::path objectsDir;
     std::filesystem::path refsDir; // Points to .minigit/refs/heads
     std::filesystem::path headFile;
+    std::filesystem::path mergeHeadFile; // Commit being merged while a merge waits for conflicts to be resolved
     std::filesystem::path configFile; // Not used yet, but good to have
 
     std::unique_ptr<StagingArea> stagingArea;
+    std::unique_ptr<CommitGraph> commitGraph; // Opened on first use, see graph()
+    std::unique_ptr<TreeMerger> treeMerger;   // Created on first use, see merger()
     std::unordered_map<std::string, std::string> branches; // branch name -> commit hash
     std::string currentBranch;
     std::string headCommit; // The hash of the commit that HEAD (or the current branch) points to.
@@ -40,6 +87,7 @@ public:
           objectsDir(minigitDir / "objects"),
           refsDir(minigitDir / "refs" / "heads") { // Correctly...
         headFile = minigitDir / "HEAD";
+        mergeHeadFile = minigitDir / "MERGE_HEAD";
         stagingArea = std::make_unique<StagingArea>(minigitDir);
         detachedHEAD = false; // Initialize to false
     }
@@ -95,12 +143,13 @@ public:
         std::string blobHash = Utils::computeHash(fileContent);
 
         // Save blob to objects directory
-        if (!Utils::writeFile(objectsDir / blobHash, fileContent)) {
+        if (!Utils::writeObject(objectsDir, blobHash, fileContent)) {
             std::cerr << "Error: Could not write blob for " << filepath << std::endl;
             return false;
         }
 
-        // Add to staging area
+        // Add to staging area (on top of what earlier 'add' commands staged)
+        stagingArea->loadIndex();
         if (!stagingArea->addFile(workingDir, relativePath.string())) {
             std::cerr << "Error: Could not add " << filepath << " to staging area." << std::endl;
             return false;
@@ -109,6 +158,37 @@ public:
         return true;
     }
 
+    // Stage the removal of a tracked file and delete it from the working directory (with
+    // cached, the file itself is kept and becomes untracked)
+    bool remove(const std::string& filepath, bool cached) {
+        std::string relativePath = std::filesystem::path(filepath).lexically_normal().generic_string();
+        stagingArea->loadIndex();
+        const SnapshotEntry* staged = stagingArea->getSnapshot().find(relativePath);
+        resolveHead();
+        bool isTree = false;
+        bool inHead = !headCommit.empty() &&
+                      !Tree::lookupPath(objectsDir, Commit::loadFromObjectStore(objectsDir, headCommit).getTree(), relativePath,
+                                        isTree).empty();
+        if (inHead && isTree) {
+            std::cerr << "Error: '" << filepath << "' is a directory; remove the files in it one by one" << std::endl;
+            return false;
+        }
+        if (!inHead && !(staged && !staged->id.isNull())) {
+            std::cerr << "Error: pathspec '" << filepath << "' did not match any tracked file" << std::endl;
+            return false;
+        }
+        stagingArea->removeFile(relativePath);
+        if (!cached) {
+            std::error_code error;
+            std::filesystem::remove(workingDir / relativePath, error);
+            if (error) {
+                std::cerr << "Error: Could not delete '" << filepath << "': " << error.message() << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
     // Commit changes
     bool commit(const std::string& message) {
         if (!std::filesystem::exists(minigitDir)) {
@@ -129,33 +209,47 @@ public:
         
         // Set parent(s)
         std::string headRefContent = Utils::readFile(headFile.string());
+        std::string parentHash;
         if (Utils::startsWith(headRefContent, "ref: ")) {
             currentBranch = headRefContent.substr(5);
             std::filesystem::path branchPath = minigitDir / currentBranch;
             std::string branchPathStr = std::string(branchPath.c_str()); // Alternative explicit conversion
             if (std::filesystem::exists(branchPath) && !Utils::readFile(branchPathStr).empty()) {
-                newCommit.addParent(Utils::readFile(branchPathStr));
+                parentHash = Utils::readFile(branchPathStr);
             }
         } else { // Detached HEAD
-            if (!headRefContent.empty()) {
-                newCommit.addParent(headRefContent);
+            parentHash = headRefContent;
+        }
+
+        // The new snapshot starts from the parent's root tree
+        std::string parentTree;
+        if (!parentHash.empty()) {
+            newCommit.addParent(parentHash);
+            Commit::Header parentHeader;
+            if (Commit::readHeader(objectsDir, parentHash, parentHeader)) {
+                parentTree = parentHeader.tree;
             }
         }
 
+        // Concluding a merge that stopped on conflicts: the merged branch is the second parent
+        std::string mergeHead = Utils::readFile(mergeHeadFile.string());
+        if (!mergeHead.empty()) {
+            newCommit.addParent(mergeHead);
+        }
+
         // Create snapshot from staging area
-        if (!newCommit.createFromStagingArea(stagingArea->getStagingPath(), objectsDir)) {
+        size_t changedFiles = stagingArea->getSnapshot().size();
+        if (!newCommit.createFromStagingArea(stagingArea->getSnapshot(), parentTree, objectsDir)) {
             std::cerr << "Error creating commit from staging area." << std::endl;
             return false;
         }
 
-        // Save the commit object
-        std::string commitHash = Utils::computeHash(newCommit.getCommitMessage() + newCommit.getAuthor() + newCommit.getTimestamp()); // Simplified hash
-        newCommit.setHash(commitHash); // Set the computed hash for the commit object
-
+        // Save the commit object; its hash is computed from the serialized commit
         if (!newCommit.saveToObjectStore(objectsDir)) {
             std::cerr << "Error saving commit object." << std::endl;
             return false;
         }
+        std::string commitHash = newCommit.getHash();
 
         // Update branch or HEAD
         if (Utils::startsWith(headRefContent, "ref: ")) {
@@ -169,72 +263,273 @@ public:
         headCommit = commitHash; // Update internal headCommit
         stagingArea->clear(); // Clear staging area after commit
         stagingArea->saveIndex(); // Save empty index
+        std::filesystem::remove(mergeHeadFile); // The merge (if any) is concluded
 
-        std::cout << newCommit.getSnapshot().size() << " files committed." << std::endl;
+        std::cout << changedFiles << " files changed." << std::endl;
         return true;
     }
 
     // Show commit history
-    void log() {
+    void log(const LogOptions& options = LogOptions()) {
         if (!std::filesystem::exists(minigitDir)) {
             std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
             return;
         }
 
-        std::string currentHash = headCommit; // Start from the current HEAD commit
-        if (currentHash.empty()) {
-            std::string headContent = Utils::readFile(headFile.string());
-            if (Utils::startsWith(headContent, "ref: ")) {
-                currentBranch = headContent.substr(5);
-                std::filesystem::path branchPath = minigitDir / currentBranch;
-                std::string branchPathStr = std::string(branchPath.c_str()); // Alternative explicit conversion
-                if (std::filesystem::exists(branchPath)) {
-                    currentHash = Utils::readFile(branchPathStr);
-                }
-            } else {
-                currentHash = headContent; // Detached HEAD
-            }
+        RevRange range;
+        if (!collectRevisions(options.revisions, options.all, range)) {
+            return;
         }
-
-        if (currentHash.empty()) {
+        if (range.include.empty()) {
             std::cout << "No commits yet." << std::endl;
             return;
         }
 
-        std::set<std::string> visited; // To prevent infinite loops in case of circular references
-        while (!currentHash.empty() && visited.find(currentHash) == visited.end()) {
-            visited.insert(currentHash);
-            Commit commit = Commit::loadFromObjectStore(objectsDir, currentHash);
+        // Commits are produced one at a time from the commit graph; only the commits
+        // actually printed are loaded from the object store. The graph drawing needs
+        // children before parents, so it always uses topological order.
+        CommitGraph& history = graph();
+        bool topoOrder = options.topoOrder || options.drawGraph;
+        RevWalker walker(history, topoOrder ? RevWalker::Order::Topo : RevWalker::Order::Date,
+                         options.firstParent);
+        for (CommitNode node : range.include) {
+            walker.push(node);
+        }
+        for (CommitNode node : range.exclude) {
+            walker.hide(node);
+        }
+
+        OutputBuffer out;
+        LogGraph lanes;
+        std::string prefix, padding; // Graph columns in front of each line (empty without --graph)
+        std::vector<CommitNode> parents;
+        CommitNode node;
+        size_t shown = 0;
+        int sinceSlop = kSinceSlop; // Commits older than --since still to look at
+        while (shown < options.maxCount && walker.next(node)) {
+            if (options.drawGraph) {
+                history.parentsOf(node, parents);
+                if (options.firstParent && parents.size() > 1) {
+                    parents.resize(1);
+                }
+            }
+            // Commit times come from the commit graph, so date limits need no object reads.
+            // In date order the frontier holds nothing newer than the commit just produced,
+            // unless a commit's clock was skewed; so the walk ends only after a few commits
+            // in a row were older than --since.
+            int64_t commitTime = history.timeOf(node);
+            if (commitTime < options.since && !topoOrder) {
+                if (--sinceSlop == 0) {
+                    break;
+                }
+            } else {
+                sinceSlop = kSinceSlop;
+            }
+            if (commitTime < options.since || commitTime > options.until ||
+                (!options.path.empty() && !touchesPath(history, node, options.path))) {
+                if (options.drawGraph) {
+                    lanes.skip(node, parents); // Keep the lanes connected through hidden commits
+                }
+                continue;
+            }
+
+            Commit commit = Commit::loadFromObjectStore(objectsDir, history.hashOf(node));
             if (!commit.isValid()) {
-                std::cerr << "Error: Could not load commit " << currentHash << std::endl;
+                out.flush();
+                std::cerr << "Error: Could not load commit " << history.hashOf(node) << std::endl;
                 break;
             }
+            if (options.drawGraph) {
+                prefix = lanes.commitLine(node);
+                padding = lanes.padding();
+            }
 
-            std::cout << "commit " << commit.getHash() << std::endl;
-            std::cout << "Author: " << commit.getAuthor() << std::endl;
-            std::cout << "Date:   " << commit.getTimestamp() << std::endl;
-            std::cout << "\n    " << commit.getCommitMessage() << std::endl;
-            
-            // Print parents (useful for merge commits)
-            if (!commit.getParents().empty()) {
-                std::cout << "Parents: ";
-                for (const auto& parent : commit.getParents()) {
-                    std::cout << parent.substr(0, 7) << " ";
+            if (options.oneline) {
+                std::string message = commit.getCommitMessage();
+                out << prefix << commit.getHash().substr(0, 7) << ' ' << message.substr(0, message.find('\n')) << '\n';
+            } else {
+                out << prefix << "commit " << commit.getHash() << '\n';
+                out << padding << "Author: " << commit.getAuthor() << '\n';
+                out << padding << "Date:   " << commit.getTimestamp() << '\n';
+                out << padding << '\n' << padding << "    " << commit.getCommitMessage() << '\n';
+
+                // Print parents (useful for merge commits)
+                if (!commit.getParents().empty()) {
+                    out << padding << "Parents: ";
+                    for (const auto& parent : commit.getParents()) {
+                        out << parent.substr(0, 7) << ' ';
+                    }
+                    out << '\n';
                 }
-                std::cout << std::endl;
+                out << padding << '\n';
             }
-            std::cout << std::endl;
 
-            if (commit.getParents().empty()) {
-                currentHash = ""; // No more parents, end of history
-            } else {
-                // For simplicity, just follow the first parent for now
-                // A more advanced log might show a DAG (Directed Acyclic Graph)
-                currentHash = commit.getParents()[0];
+            if (options.drawGraph) {
+                out << lanes.advance(parents);
             }
+            ++shown;
         }
     }
 
+    // Print the best common ancestor of two commits (all of them with showAll)
+    bool mergeBase(const std::string& ref1, const std::string& ref2, bool showAll) {
+        if (!std::filesystem::exists(minigitDir)) {
+            std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
+            return false;
+        }
+
+        std::string commit1Hash = resolveCommitRef(ref1);
+        if (commit1Hash.empty()) {
+            return false;
+        }
+        std::string commit2Hash = resolveCommitRef(ref2);
+        if (commit2Hash.empty()) {
+            return false;
+        }
+
+        std::vector<std::string> bases = graph().findMergeBases(commit1Hash, commit2Hash);
+        if (bases.empty()) {
+            return false; // No common history
+        }
+        for (const auto& base : bases) {
+            std::cout << base << "\n";
+            if (!showAll) break;
+        }
+        std::cout.flush();
+        return true;
+    }
+
+    // Merge two commits without touching the working directory or the index. Prints the
+    // merged tree (written to the object store, conflicted files with their markers), then
+    // each conflicted file's blobs by stage (1 base, 2 ours, 3 theirs; just the paths with
+    // nameOnly), then, with messages, a blank line and the merge messages. Sets clean to
+    // whether the merge had no conflicts; a favored side resolves conflicting regions.
+    bool mergeTree(const std::string& oursRef, const std::string& theirsRef, bool nameOnly, bool messages, bool& clean,
+                   MergeFavor favor = MergeFavor::None) {
+        if (!std::filesystem::exists(minigitDir)) {
+            std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
+            return false;
+        }
+
+        CommitNode ours, theirs;
+        if (!revParser().resolve(oursRef, ours) || !revParser().resolve(theirsRef, theirs)) {
+            return false;
+        }
+        TreeMergeResult merged = merger().mergeCommits(ours, theirs, oursRef, theirsRef, favor);
+        if (merged.failed) {
+            std::cerr << "Error: Could not write the merge result to the object store." << std::endl;
+            return false;
+        }
+        clean = merged.conflicts.empty();
+
+        OutputBuffer out;
+        out << merged.tree << '\n';
+        for (const auto& conflict : merged.conflicts) {
+            if (nameOnly) {
+                out << conflict.path << '\n';
+                continue;
+            }
+            const std::string* stages[] = {&conflict.baseHash, &conflict.oursHash, &conflict.theirsHash};
+            for (int stage = 1; stage <= 3; ++stage) {
+                if (!stages[stage - 1]->empty()) {
+                    out << "100644 " << *stages[stage - 1] << ' ' << stage << '\t' << conflict.path << '\n';
+                }
+            }
+        }
+        if (messages && !merged.messages.empty()) {
+            out << '\n';
+            for (const auto& message : merged.messages) {
+                out << message << '\n';
+            }
+        }
+        return true;
+    }
+
+    // Print the commits selected by revision expressions, newest first and children before
+    // parents (or just how many there are with countOnly). With leftRight and countOnly, the
+    // single revision must be "A...B" and the commits only A reaches and only B reaches are
+    // counted separately.
+    bool revList(const std::vector<std::string>& revisions, bool countOnly, bool leftRight = false) {
+        if (!std::filesystem::exists(minigitDir)) {
+            std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
+            return false;
+        }
+
+        if (leftRight) {
+            size_t dotsPos = revisions.size() == 1 ? revisions[0].find("...") : std::string::npos;
+            if (!countOnly || dotsPos == std::string::npos) {
+                std::cerr << "Error: --left-right needs --count and a single <a>...<b> range." << std::endl;
+                return false;
+            }
+            std::string left = revisions[0].substr(0, dotsPos), right = revisions[0].substr(dotsPos + 3);
+            CommitNode leftNode, rightNode;
+            RevParser parser = revParser();
+            if (!parser.resolve(left.empty() ? "HEAD" : left, leftNode) ||
+                !parser.resolve(right.empty() ? "HEAD" : right, rightNode)) {
+                return false;
+            }
+            CommitGraph::AheadBehind counts = graph().aheadBehind(leftNode, {rightNode})[0];
+            std::cout << counts.behind << "\t" << counts.ahead << std::endl;
+            return true;
+        }
+
+        RevRange range;
+        if (!collectRevisions(revisions, false, range)) {
+            return false;
+        }
+        CommitGraph& history = graph();
+        RevWalker walker(history, RevWalker::Order::Topo);
+        for (CommitNode node : range.include) {
+            walker.push(node);
+        }
+        for (CommitNode node : range.exclude) {
+            walker.hide(node);
+        }
+
+        OutputBuffer out;
+        CommitNode node;
+        size_t count = 0;
+        while (walker.next(node)) {
+            if (!countOnly) {
+                out << history.hashOf(node) << '\n';
+            }
+            ++count;
+        }
+        if (countOnly) {
+            out << count << '\n';
+        }
+        return true;
+    }
+
+    // Write the commit-graph file for every commit reachable from a branch or HEAD
+    bool writeCommitGraph() {
+        if (!std::filesystem::exists(minigitDir)) {
+            std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
+            return false;
+        }
+
+        std::vector<std::string> tips;
+        loadBranches();
+        for (const auto& [branchName, commitHash] : branches) {
+            if (!commitHash.empty()) {
+                tips.push_back(commitHash);
+            }
+        }
+        resolveHead();
+        if (!headCommit.empty()) {
+            tips.push_back(headCommit);
+        }
+
+        commitGraph.reset(); // Release the mapping before the file is replaced
+        long written = CommitGraph::write(objectsDir, tips);
+        if (written < 0) {
+            std::cerr << "Error writing commit-graph file." << std::endl;
+            return false;
+        }
+        std::cout << "Wrote commit-graph with " << written << " commits." << std::endl;
+        return true;
+    }
+
     // Create a new branch
     bool branch(const std::string& branchName) {
         if (!std::filesystem::exists(minigitDir)) {
@@ -278,8 +573,8 @@ public:
         return true;
     }
 
-    // List existing branches
-    void listBranches() {
+    // List existing branches (with verbose, also how far each is ahead of and behind HEAD)
+    void listBranches(bool verbose = false) {
         if (!std::filesystem::exists(refsDir)) {
             std::cerr << "No branches found." << std::endl;
             return;
@@ -290,16 +585,53 @@ public:
         if (Utils::startsWith(currentHeadRefContent, "ref: refs/heads/")) {
             activeBranchName = currentHeadRefContent.substr(strlen("ref: refs/heads/"));
         }
-        
-        std::cout << "Branches:" << std::endl;
+
+        std::vector<std::pair<std::string, std::string>> branchList; // (name, commit hash)
         for (const auto& entry : std::filesystem::directory_iterator(refsDir)) {
             if (entry.is_regular_file()) {
-                std::string branchName = entry.path().filename().string();
-                std::string branchCommitHash = Utils::readFile(entry.path().string());
-                std::cout << (branchName == activeBranchName ? "* " : "  ") 
-                          << branchName << " (" << branchCommitHash.substr(0, 7) << ")" << std::endl;
+                branchList.emplace_back(entry.path().filename().string(), Utils::readFile(entry.path().string()));
+            }
+        }
+
+        // One walk over the commit graph answers every branch at once
+        std::vector<CommitGraph::AheadBehind> divergence;
+        std::vector<bool> hasDivergence(branchList.size(), false);
+        resolveHead();
+        CommitNode headNode;
+        if (verbose && !headCommit.empty() && graph().lookup(headCommit, headNode)) {
+            std::vector<CommitNode> tips;
+            std::vector<size_t> tipBranches;
+            for (size_t i = 0; i < branchList.size(); ++i) {
+                CommitNode node;
+                if (!branchList[i].second.empty() && graph().lookup(branchList[i].second, node)) {
+                    tips.push_back(node);
+                    tipBranches.push_back(i);
+                    hasDivergence[i] = true;
+                }
+            }
+            std::vector<CommitGraph::AheadBehind> counts = graph().aheadBehind(headNode, tips);
+            divergence.resize(branchList.size());
+            for (size_t t = 0; t < tips.size(); ++t) {
+                divergence[tipBranches[t]] = counts[t];
             }
         }
+
+        OutputBuffer out;
+        out << "Branches:\n";
+        for (size_t i = 0; i < branchList.size(); ++i) {
+            const auto& [branchName, branchCommitHash] = branchList[i];
+            out << (branchName == activeBranchName ? "* " : "  ")
+                << branchName << " (" << std::string_view(branchCommitHash).substr(0, 7) << ")";
+            if (hasDivergence[i] && (divergence[i].ahead > 0 || divergence[i].behind > 0)) {
+                out << " [";
+                if (divergence[i].ahead > 0) out << "ahead " << divergence[i].ahead;
+                if (divergence[i].ahead > 0 && divergence[i].behind > 0) out << ", ";
+                if (divergence[i].behind > 0) out << "behind " << divergence[i].behind;
+                out << "]";
+            }
+            out << '\n';
+        }
+        out.flush();
         // If detached HEAD, display current commit
         if (!activeBranchName.empty() && Utils::startsWith(currentHeadRefContent, "ref: ")) {
             // Already handled by showing active branch
@@ -363,19 +695,17 @@ public:
             detachedHEAD = false;
             std::cout << "Switched to branch '" << ref << "'" << std::endl;
 
-        } else if (Commit::existsInObjectStore(objectsDir, ref)) {
-            // It's a commit hash
-            targetCommitHash = ref;
+        } else if (!(targetCommitHash = resolveCommitRef(ref)).empty()) {
+            // It's a commit hash (possibly abbreviated) or a revision such as HEAD~2
             // Update HEAD to point directly to the commit (detached HEAD)
-            Utils::writeFile(headFile.string(), ref);
+            Utils::writeFile(headFile.string(), targetCommitHash);
             currentBranch = ""; // No current branch when detached
             detachedHEAD = true;
-            std::cout << "Note: switching to 'HEAD~" << targetCommitHash.substr(0, 7) << "'." << std::endl;
+            std::cout << "Note: switching to '" << ref << "'." << std::endl;
             std::cout << "You are in 'detached HEAD' state." << std::endl;
             
         } else {
-            std::cerr << "Error: Reference '" << ref << "' not found. Not a valid branch or commit hash." << std::endl;
-            return false;
+            return false; // resolveCommitRef() has reported the problem
         }
 
         // Load target commit
@@ -385,8 +715,8 @@ public:
             return false;
         }
 
-        // Restore working directory to the state of the target commit
-        if (!targetCommit.restoreToWorkingDirectory(workingDir, objectsDir)) {
+        // Update only the files that differ between the current and the target commit
+        if (!updateWorkingDirectory(TreeDiff::diff(objectsDir, headCommitObj.getTree(), targetCommit.getTree()))) {
             std::cerr << "Error restoring working directory to commit " << targetCommitHash << std::endl;
             return false;
         }
@@ -413,7 +743,7 @@ public:
 
         if (Utils::startsWith(headRefContent, "ref: ")) {
             currentBranchDisplay = "On branch " + headRefContent.substr(strlen("ref: refs/heads/"));
-            std::filesystem::path currentBranchPath = minigitDir / currentBranch;
+            std::filesystem::path currentBranchPath = minigitDir / headRefContent.substr(5);
             std::string currentBranchPathStr = std::string(currentBranchPath.c_str()); // Alternative explicit conversion
             if (std::filesystem::exists(currentBranchPath)) {
                 currentHeadCommitHash = Utils::readFile(currentBranchPathStr);
@@ -424,150 +754,409 @@ public:
         }
         
         std::cout << currentBranchDisplay << std::endl;
+        if (std::filesystem::exists(mergeHeadFile)) {
+            std::cout << "You are in the middle of a merge.\n  (fix conflicts, add the files and run \"minigit commit\")" << std::endl;
+        }
 
         stagingArea->loadIndex(); // Ensure current index is loaded
 
-        std::unordered_map<std::string, std::string> headSnapshot;
+        Snapshot headSnapshot;
         if (!currentHeadCommitHash.empty()) {
             Commit headCommit = Commit::loadFromObjectStore(objectsDir, currentHeadCommitHash);
             if (headCommit.isValid()) {
                 headSnapshot = headCommit.getSnapshot();
             }
         }
+        const Snapshot& indexSnapshot = stagingArea->getSnapshot();
+        Snapshot workingDirSnapshot = WorkingTree::scan(workingDir);
+
+        // Find moved files: staged additions paired with staged removals, and untracked files
+        // paired with tracked files deleted from the working directory
+        std::vector<TreeChange> stagedChanges, worktreeChanges;
+        SnapshotJoin moves(headSnapshot, indexSnapshot, workingDirSnapshot);
+        SnapshotJoin::Row row;
+        while (moves.next(row)) {
+            const SnapshotEntry* head = row.first;
+            const SnapshotEntry* index = row.second;
+            if (index && !index->id.isNull() && !head) {
+                stagedChanges.push_back({'A', std::string(row.path), "", index->id.toString()});
+            } else if (index && index->id.isNull() && head) {
+                stagedChanges.push_back({'D', std::string(row.path), head->id.toString(), ""});
+            }
+            if (!row.third && head && !index) {
+                worktreeChanges.push_back({'D', std::string(row.path), head->id.toString(), ""});
+            } else if (row.third && !head && !index && !WorkingTree::ignoredWhenUntracked(row.path)) {
+                worktreeChanges.push_back({'A', std::string(row.path), "", row.third->id.toString()});
+            }
+        }
+        auto readObject = [this](const std::string&, const std::string& hash) {
+            return Utils::readFile(Utils::objectPath(objectsDir, hash));
+        };
+        auto readWorkingFile = [this](const std::string& path, const std::string&) {
+            return Utils::readFile(workingDir / path);
+        };
+        std::unordered_map<std::string_view, std::string> movedFrom; // New path -> old path
+        std::unordered_set<std::string_view> movedAway;
+        for (const auto& rename : RenameDetector::detect(stagedChanges, readObject, readObject)) {
+            movedFrom[PathPool::global().intern(rename.newPath)] = rename.oldPath;
+            movedAway.insert(PathPool::global().intern(rename.oldPath));
+        }
+        for (const auto& rename : RenameDetector::detect(worktreeChanges, readObject, readWorkingFile)) {
+            movedFrom[PathPool::global().intern(rename.newPath)] = rename.oldPath;
+            movedAway.insert(PathPool::global().intern(rename.oldPath));
+        }
+
+        // Walk HEAD, the index and the working directory side by side in path order and
+        // sort each path into one of the three sections
+        std::stringstream staged, notStaged, untracked;
+        SnapshotJoin join(headSnapshot, indexSnapshot, workingDirSnapshot);
+        while (join.next(row)) {
+            std::string_view filepath = row.path;
+            const SnapshotEntry* head = row.first;
+            const SnapshotEntry* index = row.second;
+            const SnapshotEntry* workingDirFile = row.third;
+            bool inStaged = index && !index->id.isNull();
+            bool inRemoved = index && index->id.isNull();
+
+            // Changes to be committed: index compared against HEAD
+            auto moved = movedFrom.find(filepath);
+            if (inStaged && !head) {
+                if (moved != movedFrom.end()) {
+                    staged << "\trenamed:  " << moved->second << " -> " << filepath << "\n";
+                } else {
+                    staged << "\tnew file: " << filepath << "\n";
+                }
+            } else if (inStaged && head->id != index->id) {
+                staged << "\tmodified: " << filepath << "\n";
+            } else if (inRemoved && !movedAway.count(filepath)) {
+                staged << "\tdeleted:  " << filepath << "\n";
+            }
 
-        // Get current working directory files and their hashes
-        std::unordered_map<std::string, std::string> workingDirFiles;
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(workingDir)) {
-            if (entry.is_regular_file()) {
-                std::filesystem::path relativePath = std::filesystem::relative(entry.path(), workingDir);
-                if (relativePath.string().rfind(".minigit", 0) != 0 && relativePath.string().rfind(".git", 0) != 0) { // Ignore .minigit and .git directories
-                    // Also ignore .gitignore itself
-                    if (relativePath.string() == ".gitignore") continue;
-
-                    std::string fileContent = Utils::readFile(entry.path().string());
-                    workingDirFiles[relativePath.string()] = Utils::computeHash(fileContent);
+            // Changes not staged for commit: working directory compared against index/HEAD
+            if (workingDirFile) {
+                if (inStaged) {
+                    if (index->id != workingDirFile->id) {
+                        notStaged << "\tmodified: " << filepath << "\n";
+                    }
+                } else if (inRemoved) {
+                    // File is marked for removal, but still exists in working directory with content
+                    if (!head || head->id != workingDirFile->id) {
+                        notStaged << "\tmodified: " << filepath << " (deleted but modified)\n";
+                    }
+                } else if (head) {
+                    if (head->id != workingDirFile->id) {
+                        notStaged << "\tmodified: " << filepath << "\n";
+                    }
+                } else if (moved != movedFrom.end()) {
+                    // Untracked file holding the content of a deleted tracked file
+                    notStaged << "\trenamed:  " << moved->second << " -> " << filepath << "\n";
+                } else if (!WorkingTree::ignoredWhenUntracked(filepath)) {
+                    // Untracked files (not in HEAD, not in staging, but in working directory)
+                    untracked << "\t" << filepath << "\n";
                 }
+            } else if (inStaged) {
+                // A staged file was deleted from the working directory without 'rm'
+                notStaged << "\tdeleted:  " << filepath << " (staged but deleted from working directory)\n";
+            } else if (head && !inRemoved && !movedAway.count(filepath)) {
+                notStaged << "\tdeleted:  " << filepath << "\n";
             }
         }
-        
-        bool changesToBeCommitted = false;
-        bool changesNotStagedForCommit = false;
-        bool untrackedFiles = false;
 
         std::cout << "\nChanges to be committed:" << std::endl;
         std::cout << "  (use \"minigit restore --staged <file>...\" to unstage)" << std::endl;
         std::cout << "  (use \"minigit rm --cached <file>...\" to unstage)" << std::endl; // More traditional git language
-
-        // Files added to staging area
-        for (const auto& [filepath, stagedHash] : stagingArea->getStagedFiles()) {
-            // If the file was in HEAD and its hash changed, it's a modification
-            // If it wasn't in HEAD, it's a new file (addition)
-            if (headSnapshot.count(filepath) && headSnapshot.at(filepath) != stagedHash) {
-                std::cout << "\tmodified: " << filepath << std::endl;
-                changesToBeCommitted = true;
-            } else if (!headSnapshot.count(filepath)) {
-                std::cout << "\tnew file: " << filepath << std::endl;
-                changesToBeCommitted = true;
-            } else if (headSnapshot.count(filepath) && headSnapshot.at(filepath) == stagedHash) {
-                // If file is staged and its hash matches HEAD's hash, it means it was previously modified and committed, but now staged again without change
-                // or it was in HEAD, deleted from WD, then re-added back to staging matching HEAD
-                // This case handles a 're-add' of an unchanged file. It should ideally not show up here unless the status is more granular.
-                // For simplicity, we assume 'added' or 'modified' means change from HEAD.
-                // If it reaches here, it means it's staged but hasn't changed from HEAD. This case might be tricky if not covered in UX.
-                 std::cout << "\tmodified: " << filepath << " (staged, no content change from HEAD)" << std::endl;
-                 changesToBeCommitted = true; // Still considered a staged change
-            }
-        }
-        // Files marked for removal
-        for (const auto& removedFilepath : stagingArea->getRemovedFiles()) {
-            std::cout << "\tdeleted:  " << removedFilepath << std::endl;
-            changesToBeCommitted = true;
-        }
-        if (!changesToBeCommitted) {
+        std::cout << staged.str();
+        if (staged.tellp() == 0) {
             std::cout << "  (no changes staged for commit)" << std::endl;
         }
 
         std::cout << "\nChanges not staged for commit:" << std::endl;
         std::cout << "  (use \"minigit add <file>...\" to update what will be committed)" << std::endl;
         std::cout << "  (use \"minigit restore <file>...\" to discard changes in working directory)" << std::endl;
+        std::cout << notStaged.str();
+        if (notStaged.tellp() == 0) {
+            std::cout << "  (no changes not staged for commit)" << std::endl;
+        }
 
-        // Modified files not staged
-        for (const auto& [filepath, wdHash] : workingDirFiles) {
-            bool inStaged = stagingArea->getStagedFiles().count(filepath);
-            bool inRemoved = stagingArea->getRemovedFiles().count(filepath);
-            
-            if (inStaged) {
-                // File is staged, but working directory version is different
-                if (stagingArea->getStagedFiles().at(filepath) != wdHash) {
-                    std::cout << "\tmodified: " << filepath << std::endl;
-                    changesNotStagedForCommit = true;
-                }
-            } else if (inRemoved) {
-                // File is marked for removal, but still exists in working directory with content
-                std::string headHash = headSnapshot.count(filepath) ? headSnapshot.at(filepath) : "";
-                if (headHash != wdHash) { // Modified since deletion or new file
-                    std::cout << "\tmodified: " << filepath << " (deleted but modified)" << std::endl;
-                    changesNotStagedForCommit = true;
-                }
-            }
-            else { // Not in staged or removed, check against HEAD
-                if (headSnapshot.count(filepath)) {
-                    if (headSnapshot.at(filepath) != wdHash) {
-                        std::cout << "\tmodified: " << filepath << std::endl;
-                        changesNotStagedForCommit = true;
-                    }
-                }
+        std::cout << "\nUntracked files:" << std::endl;
+        std::cout << "  (use \"minigit add <file>...\" to include in what will be committed)" << std::endl;
+        std::cout << untracked.str();
+        if (untracked.tellp() == 0) {
+            std::cout << "  (nothing to commit, working tree clean)" << std::endl;
+        }
+    }
+
+    // Merge a branch into the current branch. With a favored side (-X ours or -X theirs),
+    // regions and binary files both sides changed take that side's version.
+    bool merge(const std::string& branchToMergeName, MergeFavor favor = MergeFavor::None) {
+        if (!checkReadyToMerge()) {
+            return false;
+        }
+        return mergeBranch(branchToMergeName, favor);
+    }
+
+    // Merge several branches into the current branch in one commit (an octopus merge). The
+    // branches are folded into the current tree one after another in the object store, and
+    // the result becomes a single commit with HEAD and every branch as parents, so the
+    // working directory is written once. Branches HEAD or another of the branches already
+    // contains are left out. An octopus merge that conflicts is refused before anything is
+    // changed.
+    bool mergeOctopus(const std::vector<std::string>& branchNames, MergeFavor favor = MergeFavor::None) {
+        if (!checkReadyToMerge()) {
+            return false;
+        }
+        std::string headRefContent = Utils::readFile(headFile.string());
+        if (!Utils::startsWith(headRefContent, "ref: ")) {
+            std::cerr << "Error: An octopus merge needs a current branch (HEAD is detached)." << std::endl;
+            return false;
+        }
+        std::string currentBranch = headRefContent.substr(strlen("ref: refs/heads/"));
+        std::string currentCommitHash = Utils::readFile(refsDir / currentBranch);
+        CommitNode headNode;
+        if (currentCommitHash.empty() || !graph().lookup(currentCommitHash, headNode)) {
+            std::cerr << "Error: Current branch '" << currentBranch << "' has no commits." << std::endl;
+            return false;
+        }
+
+        std::vector<CommitNode> branchNodes;
+        for (const auto& branchName : branchNames) {
+            std::string branchHash = Utils::readFile(refsDir / branchName);
+            CommitNode branchNode;
+            if (branchHash.empty() || !graph().lookup(branchHash, branchNode)) {
+                std::cerr << "Error: Branch to merge '" << branchName << "' has no commits." << std::endl;
+                return false;
             }
+            branchNodes.push_back(branchNode);
         }
 
-        // Deleted files not staged (present in HEAD/staged, but not in working directory, and not marked for removal)
-        for (const auto& [filepath, headHash] : headSnapshot) {
-            if (!workingDirFiles.count(filepath) && !stagingArea->getStagedFiles().count(filepath) && !stagingArea->getRemovedFiles().count(filepath)) {
-                std::cout << "\tdeleted:  " << filepath << std::endl;
-                changesNotStagedForCommit = true;
+        // Reduce the heads: a branch HEAD or another branch reaches would only be a
+        // redundant parent (of the same commit named twice, the first is kept)
+        std::vector<CommitNode> mergedNodes = {headNode}; // Commits merged, HEAD first
+        std::vector<std::string> mergedNames;
+        for (size_t i = 0; i < branchNodes.size(); ++i) {
+            if (graph().isAncestor(branchNodes[i], headNode)) {
+                std::cout << "Already up to date with " << branchNames[i] << std::endl;
+                continue;
             }
+            bool redundant = false;
+            for (size_t j = 0; j < branchNodes.size() && !redundant; ++j) {
+                redundant = branchNodes[j] == branchNodes[i] ? j < i : graph().isAncestor(branchNodes[i], branchNodes[j]);
+            }
+            if (!redundant) {
+                mergedNodes.push_back(branchNodes[i]);
+                mergedNames.push_back(branchNames[i]);
+            }
+        }
+        if (mergedNames.empty()) {
+            std::cout << "Already up-to-date." << std::endl;
+            return true;
         }
-        for (const auto& [filepath, stagedHash] : stagingArea->getStagedFiles()) {
-            if (!workingDirFiles.count(filepath) && !stagingArea->getRemovedFiles().count(filepath)) {
-                // This means a staged file was deleted from WD, but not removed from staging.
-                // This should be caught by "changes to be committed" as a deletion if rm was used,
-                // or "changes not staged" as a deletion if simply removed from WD.
-                // For now, let's consider it 'deleted' from WD, if not in removedFiles and not in WD.
-                std::cout << "\tdeleted:  " << filepath << " (staged but deleted from working directory)" << std::endl;
-                changesNotStagedForCommit = true;
+        if (mergedNames.size() == 1) {
+            return mergeBranch(mergedNames.front(), favor); // An ordinary merge (or a fast-forward)
+        }
+
+        // Fold each branch into the tree merged so far. Its base is the best common ancestors
+        // of the branch and the commits already merged, as one virtual ancestor if several.
+        std::string headTree = graph().treeOf(headNode);
+        std::string octopusTree = headTree;
+        for (size_t i = 0; i < mergedNames.size(); ++i) {
+            CommitNode branchNode = mergedNodes[i + 1];
+            std::cout << "Trying simple merge with " << mergedNames[i] << std::endl;
+            std::string baseTree;
+            if (!merger().mergeBaseTree(std::vector<CommitNode>(mergedNodes.begin(), mergedNodes.begin() + i + 1),
+                                        branchNode, baseTree)) {
+                std::cerr << "Error: Could not write the merge result to the object store." << std::endl;
+                return false;
+            }
+            const TreeMergeResult& merged = merger().mergeTrees(baseTree, octopusTree, graph().treeOf(branchNode),
+                                                                "HEAD", mergedNames[i], favor);
+            for (const auto& message : merged.messages) {
+                (Utils::startsWith(message, "Error") ? std::cerr : std::cout) << message << std::endl;
+            }
+            if (merged.failed) {
+                std::cerr << "Error: Could not write the merge result to the object store." << std::endl;
+                return false;
+            }
+            if (!merged.conflicts.empty()) {
+                std::cerr << "Error: Merging '" << mergedNames[i] << "' conflicts with the branches merged before it." << std::endl;
+                std::cerr << "Nothing was changed; merge these branches one at a time to resolve the conflicts." << std::endl;
+                return false;
             }
+            octopusTree = merged.tree;
         }
 
-        if (!changesNotStagedForCommit) {
-            std::cout << "  (no changes not staged for commit)" << std::endl;
+        std::string mergeMessage = "Merge branches ";
+        for (size_t i = 0; i < mergedNames.size(); ++i) {
+            mergeMessage += (i == 0 ? "'" : i + 1 == mergedNames.size() ? " and '" : ", '") + mergedNames[i] + "'";
+        }
+        mergeMessage += " into " + currentBranch;
+        Commit mergeCommit(mergeMessage);
+        for (CommitNode node : mergedNodes) {
+            mergeCommit.addParent(graph().hashOf(node)); // HEAD first, then the branches in the order given
+        }
+        mergeCommit.setTree(octopusTree, objectsDir);
+        if (!mergeCommit.saveToObjectStore(objectsDir)) {
+            std::cerr << "Error saving merge commit object." << std::endl;
+            return false;
         }
+        std::string mergeCommitHash = mergeCommit.getHash();
+        writeBranchRef(currentBranch, mergeCommitHash);
+        headCommit = mergeCommitHash;
 
-        std::cout << "\nUntracked files:" << std::endl;
-        std::cout << "  (use \"minigit add <file>...\" to include in what will be committed)" << std::endl;
+        // One pass over the working directory for all branches together
+        updateWorkingDirectory(TreeDiff::diff(objectsDir, headTree, octopusTree));
+        stagingArea->clear();
+        stagingArea->saveIndex();
+
+        std::cout << "Merge made by the 'octopus' strategy. Created merge commit " << mergeCommitHash.substr(0, 7) << std::endl;
+        return true;
+    }
+
+    // Show changes as a unified diff (or just the changed files with nameStatus): between
+    // the working directory and the index, between the index and HEAD (cached), or between
+    // two commits ("A B", "A..B", or "A...B" for B against the merge base of A and B)
+    bool diff(const DiffOptions& options) {
+        if (!std::filesystem::exists(minigitDir)) {
+            std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
+            return false;
+        }
+
+        std::vector<TreeChange> changes;
+        bool newFromWorkingDir = false;
+        if (!options.revisions.empty()) {
+            std::string oldCommitHash, newCommitHash;
+            if (!resolveDiffRevisions(options.revisions, oldCommitHash, newCommitHash)) {
+                return false;
+            }
+            Commit oldCommit = Commit::loadFromObjectStore(objectsDir, oldCommitHash);
+            Commit newCommit = Commit::loadFromObjectStore(objectsDir, newCommitHash);
+            changes = TreeDiff::diff(objectsDir, oldCommit.getTree(), newCommit.getTree());
+        } else {
+            resolveHead();
+            Snapshot headSnapshot;
+            if (!headCommit.empty()) {
+                headSnapshot = Commit::loadFromObjectStore(objectsDir, headCommit).getSnapshot();
+            }
+            stagingArea->loadIndex();
+            Snapshot indexSnapshot = indexedSnapshot(headSnapshot);
+            if (options.cached) {
+                changes = diffSnapshots(headSnapshot, indexSnapshot, false);
+            } else {
+                // Untracked files are not part of the comparison
+                changes = diffSnapshots(indexSnapshot, WorkingTree::scan(workingDir), true);
+                newFromWorkingDir = true;
+            }
+        }
+
+        auto readObject = [this](const std::string&, const std::string& hash) {
+            return hash.empty() ? std::string() : Utils::readFile(Utils::objectPath(objectsDir, hash));
+        };
+        auto readNew = [&](const std::string& path, const std::string& hash) {
+            return newFromWorkingDir && !hash.empty() ? Utils::readFile(workingDir / path) : readObject(path, hash);
+        };
+
+        // Moved files are shown once, at their new path; the old path is left out unless
+        // the file was copied
+        std::vector<RenamePair> renames;
+        if (options.findRenames || options.findCopies) {
+            renames = RenameDetector::detect(changes, readObject, readNew, options.renameThreshold, options.findCopies);
+        }
+        std::unordered_map<std::string_view, const RenamePair*> renameByNewPath;
+        std::unordered_set<std::string_view> movedPaths;
+        for (const auto& rename : renames) {
+            renameByNewPath[rename.newPath] = &rename;
+            if (!rename.copy) {
+                movedPaths.insert(rename.oldPath);
+            }
+        }
+
+        OutputBuffer out;
+        for (const auto& change : changes) {
+            if (movedPaths.count(change.path)) {
+                continue;
+            }
+            auto renameIt = renameByNewPath.find(change.path);
+            const RenamePair* rename = renameIt == renameByNewPath.end() ? nullptr : renameIt->second;
+            const std::string& oldPath = rename ? rename->oldPath : change.path;
+            const std::string& oldHash = rename ? rename->oldHash : change.oldHash;
+            char status = rename ? (rename->copy ? 'C' : 'R') : change.status;
+            if (options.nameStatus) {
+                if (rename) {
+                    // Similarity as three digits, e.g. R087
+                    out << status << (rename->similarity < 100 ? "0" : "") << (rename->similarity < 10 ? "0" : "")
+                        << rename->similarity << '\t' << oldPath << '\t' << change.path << '\n';
+                } else {
+                    out << status << '\t' << change.path << '\n';
+                }
+                continue;
+            }
 
-        // Untracked files (not in HEAD, not in staging, but in working directory)
-        for (const auto& [filepath, wdHash] : workingDirFiles) {
-            if (!headSnapshot.count(filepath) && !stagingArea->getStagedFiles().count(filepath) && !stagingArea->getRemovedFiles().count(filepath)) {
-                std::cout << "\t" << filepath << std::endl;
-                untrackedFiles = true;
+            out << "diff --git a/" << oldPath << " b/" << change.path << '\n';
+            if (status == 'A') {
+                out << "new file mode 100644\n";
+            } else if (status == 'D') {
+                out << "deleted file mode 100644\n";
+            } else if (rename) {
+                const char* kind = rename->copy ? "copy" : "rename";
+                out << "similarity index " << rename->similarity << "%\n"
+                    << kind << " from " << oldPath << '\n'
+                    << kind << " to " << change.path << '\n';
+                if (oldHash == change.newHash) {
+                    continue; // Moved without changes: no patch
+                }
             }
-            // Add a specific check to ignore .gitignore if it's untracked.
-            if (filepath == ".gitignore") {
-                untrackedFiles = false; // Don't list .gitignore as untracked
+            out << "index " << (oldHash.empty() ? "0000000" : std::string_view(oldHash).substr(0, 7))
+                << ".." << (change.newHash.empty() ? "0000000" : std::string_view(change.newHash).substr(0, 7))
+                << (status == 'A' || status == 'D' ? "\n" : " 100644\n");
+
+            // Binary files are not line-diffed; blobs in the object store are checked
+            // before being read in full
+            BinaryDetector& detector = BinaryDetector::global();
+            std::string newContent = newFromWorkingDir ? readNew(change.path, change.newHash) : std::string();
+            bool binary = detector.isBinaryBlob(objectsDir, oldHash) ||
+                          (newFromWorkingDir ? detector.isBinaryContent(change.newHash, newContent)
+                                             : detector.isBinaryBlob(objectsDir, change.newHash));
+            if (binary) {
+                out << "Binary files " << (status == 'A' ? "/dev/null" : "a/" + oldPath)
+                    << " and " << (status == 'D' ? "/dev/null" : "b/" + change.path) << " differ\n";
+                continue;
             }
+            if (status == 'A') out << "--- /dev/null\n";
+            else out << "--- a/" << oldPath << '\n';
+            if (status == 'D') out << "+++ /dev/null\n";
+            else out << "+++ b/" << change.path << '\n';
+            std::string oldContent = readObject(oldPath, oldHash);
+            if (!newFromWorkingDir) {
+                newContent = readObject(change.path, change.newHash);
+            }
+            LineDiff(oldContent, newContent, options.algorithm).writeUnified(out, options.context);
         }
-        if (!untrackedFiles) {
-            std::cout << "  (nothing to commit, working tree clean)" << std::endl;
+        return true;
+    }
+
+private:
+    // Helper to open the commit graph on first use
+    CommitGraph& graph() {
+        if (!commitGraph) {
+            commitGraph = std::make_unique<CommitGraph>(objectsDir);
         }
+        return *commitGraph;
     }
 
-    // Merge a branch into the current branch
-    bool merge(const std::string& branchToMergeName) {
+    // Helper to check that a merge may start: no merge is waiting to be concluded, and the
+    // working directory has no changes the merge could overwrite
+    bool checkReadyToMerge() {
         if (!std::filesystem::exists(minigitDir)) {
             std::cerr << "Error: Not a MiniGit repository (or any of the parent directories): " << workingDir << std::endl;
             return false;
         }
         
+        if (std::filesystem::exists(mergeHeadFile)) {
+            std::cerr << "Error: You have not concluded your merge (MERGE_HEAD exists)." << std::endl;
+            std::cerr << "Please resolve the conflicts and commit before merging again." << std::endl;
+            return false;
+        }
+
         // 0. Ensure no unstaged changes
         stagingArea->loadIndex();
         std::string currentHeadCommitHash;
@@ -592,10 +1181,16 @@ public:
             std::cerr << "Please commit your changes or stash them before you merge." << std::endl;
             return false;
         }
+        return true;
+    }
+
+    // Helper to merge a branch into the current branch, once checkReadyToMerge() passed
+    bool mergeBranch(const std::string& branchToMergeName, MergeFavor favor) {
+        std::string headRefContent = Utils::readFile(headFile.string());
 
         // 1. Get current branch and branch to merge commits
         std::string currentBranch = headRefContent.substr(strlen("ref: refs/heads/")); // Assuming not detached HEAD
-        std::string currentCommitHash = Utils::readFile(minigitDir / currentBranch);
+        std::string currentCommitHash = Utils::readFile(refsDir / currentBranch);
         std::string otherCommitHash = Utils::readFile(refsDir / branchToMergeName);
 
         if (currentCommitHash.empty()) {
@@ -621,20 +1216,20 @@ public:
 
         // 2. Check for fast-forward merge
         // If otherCommit is an ancestor of currentCommit, then current branch already contains otherCommit's history
-        if (Commit::isAncestor(objectsDir, otherCommitHash, currentCommitHash)) {
+        if (graph().isAncestor(otherCommitHash, currentCommitHash)) {
             std::cout << "Already up-to-date." << std::endl;
             return true;
         }
 
         // If currentCommit is an ancestor of otherCommit
-        if (Commit::isAncestor(objectsDir, currentCommitHash, otherCommitHash)) {
+        if (graph().isAncestor(currentCommitHash, otherCommitHash)) {
             std::cout << "Fast-forward merge detected." << std::endl;
             // Move current branch to otherCommit
             writeBranchRef(currentBranch, otherCommitHash);
             headCommit = otherCommitHash;
             branches[currentBranch] = otherCommitHash;
-            // Restore working directory to otherCommit's state
-            otherCommit.restoreToWorkingDirectory(workingDir, objectsDir);
+            // Bring the working directory to otherCommit's state, touching only changed files
+            updateWorkingDirectory(TreeDiff::diff(objectsDir, currentCommit.getTree(), otherCommit.getTree()));
             stagingArea->clear(); // Clear staging area after fast-forward
             stagingArea->saveIndex();
             std::cout << "Updated branch '" << currentBranch << "' to " << otherCommitHash.substr(0, 7) << "." << std::endl;
@@ -644,123 +1239,293 @@ public:
         // 2. Three-way merge
         std::cout << "Performing a three-way merge..." << std::endl;
 
-        std::string lcaHash = Commit::findLCA(objectsDir, currentCommitHash, otherCommitHash);
-        if (lcaHash.empty()) {
+        CommitNode currentNode, otherNode;
+        if (!graph().lookup(currentCommitHash, currentNode) || !graph().lookup(otherCommitHash, otherNode) ||
+            graph().findMergeBases(currentNode, otherNode).empty()) {
             std::cerr << "Error: Could not find a common ancestor for merge." << std::endl;
             return false;
         }
 
-        Commit lcaCommit = Commit::loadFromObjectStore(objectsDir, lcaHash);
-        if (!lcaCommit.isValid()) {
-            std::cerr << "Error: Could not load common ancestor commit " << lcaHash << std::endl;
+        // The merge itself happens in the object store; with several merge bases (criss-cross
+        // history) they are first merged into a virtual ancestor
+        TreeMergeResult merged = merger().mergeCommits(currentNode, otherNode, "HEAD", branchToMergeName, favor);
+        for (const auto& message : merged.messages) {
+            (Utils::startsWith(message, "Error") ? std::cerr : std::cout) << message << std::endl;
+        }
+        if (merged.failed) {
+            std::cerr << "Error: Could not write the merge result to the object store." << std::endl;
             return false;
         }
 
-        // Perform merge logic:
-        // Get snapshots of LCA, current, and other commits
-        const auto& lcaSnapshot = lcaCommit.getSnapshot();
-        const auto& currentSnapshot = currentCommit.getSnapshot();
-        const auto& otherSnapshot = otherCommit.getSnapshot();
+        // Files the merge changes relative to HEAD: only these are written to the working
+        // directory (which matches HEAD, as checked above), conflicted files with their markers
+        std::vector<TreeChange> worktreeChanges = merged.changes;
+        for (const auto& conflict : merged.conflicts) {
+            worktreeChanges.push_back({'M', conflict.path, "", conflict.hash});
+        }
+        std::string mergeMessage = "Merge branch '" + branchToMergeName + "' into " + currentBranch;
 
-        // Create a map for merged snapshot and a set for conflicts
-        std::unordered_map<std::string, std::string> mergedSnapshot = currentSnapshot; // Start with current branch's snapshot
-        std::vector<std::string> conflictFiles;
-        
-        // Track which files were processed to avoid duplicate conflict checks
-        std::set<std::string> allFiles;
-        for (const auto& pair : lcaSnapshot) allFiles.insert(pair.first);
-        for (const auto& pair : currentSnapshot) allFiles.insert(pair.first);
-        for (const auto& pair : otherSnapshot) allFiles.insert(pair.first);
-
-        for (const std::string& filepath : allFiles) {
-            bool inLCA = lcaSnapshot.count(filepath);
-            bool inCurrent = currentSnapshot.count(filepath);
-            bool inOther = otherSnapshot.count(filepath);
-
-            std::string lcaHash_file = inLCA ? lcaSnapshot.at(filepath) : "";
-            std::string currentHash_file = inCurrent ? currentSnapshot.at(filepath) : "";
-            std::string otherHash_file = inOther ? otherSnapshot.at(filepath) : "";
-
-            if (currentHash_file == otherHash_file) {
-                // Both branches have the same version, no conflict, use it
-                mergedSnapshot[filepath] = currentHash_file;
-            } else if (lcaHash_file == currentHash_file) {
-                // Current branch didn't change, but other branch did (or added)
-                if (inOther) {
-                    mergedSnapshot[filepath] = otherHash_file; // Take other's version
-                } else {
-                    mergedSnapshot.erase(filepath); // Deleted in other
-                }
-            } else if (lcaHash_file == otherHash_file) {
-                // Other branch didn't change, but current branch did (or added)
-                if (inCurrent) {
-                    mergedSnapshot[filepath] = currentHash_file; // Take current's version
-                } else {
-                    mergedSnapshot.erase(filepath); // Deleted in current
-                }
-            } else {
-                // Both changed differently, or one changed and other deleted etc. -> CONFLICT!
-                conflictFiles.push_back(filepath);
-                
-                std::cout << "CONFLICT (content): Merge conflict in " << filepath << std::endl;
-                
-                // Write conflict markers to the working directory
-                std::string lcaContent = lcaHash_file.empty() ? "" : Utils::readFile(objectsDir / lcaHash_file);
-                std::string currentContent = currentHash_file.empty() ? "" : Utils::readFile(objectsDir / currentHash_file);
-                std::string otherContent = otherHash_file.empty() ? "" : Utils::readFile(objectsDir / otherHash_file);
-
-                std::string conflictContent = "<<<<<<< HEAD\n" +
-                                              currentContent + "\n" +
-                                              "=======\n" +
-                                              otherContent + "\n" +
-                                              ">>>>>>> " + branchToMergeName + "\n";
-                Utils::writeFile(workingDir / filepath, conflictContent); // Write to working directory for user to resolve
+        if (!merged.conflicts.empty()) {
+            // Leave the merge for the user to finish: the clean changes are applied and staged
+            // in one index write, and the next commit records the other branch as second parent
+            updateWorkingDirectory(worktreeChanges);
+            for (const auto& change : merged.changes) {
+                stagingArea->stage(change.path, change.newHash.empty() ? ObjectId() : ObjectId(change.newHash));
             }
-        }
-        
-        if (!conflictFiles.empty()) {
+            stagingArea->saveIndex();
+            Utils::writeFile(mergeHeadFile.string(), otherCommitHash);
             std::cerr << "Automatic merge failed; fix conflicts and then commit the result." << std::endl;
             return false; // Indicate merge failed due to conflicts
         }
 
         // If merge successful, create new merge commit
-        std::string mergeMessage = "Merge branch '" + branchToMergeName + "' into " + currentBranch;
         Commit mergeCommit(mergeMessage);
         mergeCommit.addParent(currentCommitHash); // First parent: current branch HEAD
         mergeCommit.addParent(otherCommitHash);   // Second parent: merged branch HEAD
+        mergeCommit.setTree(merged.tree, objectsDir);
 
-        // Set the merged snapshot
-        mergeCommit.setSnapshot(mergedSnapshot); // Set the snapshot directly
-
-        // Generate hash and save merge commit
-        std::string mergeCommitHash = Utils::computeHash(mergeCommit.getCommitMessage() + mergeCommit.getAuthor() + mergeCommit.getTimestamp());
-        mergeCommit.setHash(mergeCommitHash);
-
+        // Save merge commit; its hash is computed from the serialized commit
         if (!mergeCommit.saveToObjectStore(objectsDir)) {
             std::cerr << "Error saving merge commit object." << std::endl;
             return false;
         }
+        std::string mergeCommitHash = mergeCommit.getHash();
 
         // Update the current branch to point to the new merge commit
         writeBranchRef(currentBranch, mergeCommitHash);
         headCommit = mergeCommitHash; // Update internal headCommit
 
-        // Restore working directory to merged state (this should already be handled by conflict writing,
-        // but for non-conflicting files, ensure they are correct.)
-        mergeCommit.restoreToWorkingDirectory(workingDir, objectsDir);
-        
-        // Clear staging area and add all merged files to staging
+        // Write only the files the merge changed, then reset the index to the new HEAD in a
+        // single write
+        updateWorkingDirectory(worktreeChanges);
         stagingArea->clear();
-        for (const auto& pair : mergedSnapshot) {
-            stagingArea->addFile(workingDir, pair.first); // This will re-hash and stage
-        }
         stagingArea->saveIndex();
 
         std::cout << "Merge complete. Created merge commit " << mergeCommitHash.substr(0, 7) << std::endl;
         return true;
     }
 
-private:
+    // Helper to create the merge engine on first use; its cache of tree merges is shared by
+    // all merges of this command
+    TreeMerger& merger() {
+        if (!treeMerger) {
+            treeMerger = std::make_unique<TreeMerger>(objectsDir, graph());
+        }
+        return *treeMerger;
+    }
+
+    // Helper to evaluate a revision (e.g. "master", "HEAD~3", "1234abc^2") to a commit hash.
+    // Reports an error and returns "" if it does not name a commit.
+    std::string resolveCommitRef(const std::string& ref) {
+        CommitNode node;
+        if (!revParser().resolve(ref, node)) {
+            return "";
+        }
+        return graph().hashOf(node);
+    }
+
+    // Helper to create a revision parser whose names are resolved by resolveName()
+    RevParser revParser() {
+        return RevParser(graph(), [this](const std::string& name) { return resolveName(name); });
+    }
+
+    // Helper to resolve "HEAD", a branch name or a full or abbreviated commit hash to a
+    // commit hash ("" if unknown or ambiguous)
+    std::string resolveName(const std::string& ref) {
+        if (ref == "HEAD") {
+            resolveHead();
+            return headCommit;
+        }
+        if (!ref.empty() && std::filesystem::exists(refsDir / ref)) {
+            return Utils::readFile((refsDir / ref).string());
+        }
+        if (!ref.empty() && Commit::existsInObjectStore(objectsDir, ref)) {
+            return ref;
+        }
+        return resolveAbbreviatedCommit(ref);
+    }
+
+    // Helper to expand a unique prefix (at least 4 characters) of a commit hash. Only the
+    // prefix's fan-out directory is read, and only matching objects are checked for being
+    // commits. An ambiguous prefix is reported together with the candidate commits.
+    std::string resolveAbbreviatedCommit(const std::string& prefix) {
+        if (prefix.size() < 4) {
+            return "";
+        }
+        std::vector<std::string> commits;
+        for (const auto& hash : Utils::findObjectsByPrefix(objectsDir, prefix)) {
+            Commit::Header header;
+            if (Commit::readHeader(objectsDir, hash, header)) {
+                commits.push_back(hash);
+            }
+        }
+        if (commits.size() == 1) {
+            return commits.front();
+        }
+        if (commits.size() > 1) {
+            std::cerr << "Error: Short commit hash '" << prefix << "' is ambiguous. The candidates are:" << std::endl;
+            for (const auto& hash : commits) {
+                Commit candidate = Commit::loadFromObjectStore(objectsDir, hash);
+                std::string message = candidate.getCommitMessage();
+                std::cerr << "  " << hash << " " << candidate.getTimestamp() << " - "
+                          << message.substr(0, message.find('\n')) << std::endl;
+            }
+        }
+        return "";
+    }
+
+    // Helper to turn revision arguments into the commits to walk from and to hide. No
+    // arguments means HEAD (nothing at all before the first commit); withAll adds every branch.
+    bool collectRevisions(const std::vector<std::string>& revisions, bool withAll, RevRange& range) {
+        RevParser parser = revParser();
+        for (const auto& revision : revisions) {
+            if (!parser.addToRange(revision, range)) {
+                return false;
+            }
+        }
+
+        std::vector<std::string> startHashes;
+        if (revisions.empty()) {
+            resolveHead();
+            if (!headCommit.empty()) {
+                startHashes.push_back(headCommit);
+            }
+        }
+        if (withAll) {
+            loadBranches();
+            for (const auto& [branchName, commitHash] : branches) {
+                if (!commitHash.empty()) {
+                    startHashes.push_back(commitHash);
+                }
+            }
+        }
+        for (const auto& startHash : startHashes) {
+            CommitNode node;
+            if (!graph().lookup(startHash, node)) {
+                std::cerr << "Error: Could not load commit " << startHash << std::endl;
+                return false;
+            }
+            range.include.push_back(node);
+        }
+        return true;
+    }
+
+    // Helper to check whether a commit changed a path (file or directory) compared to its
+    // first parent. The commit's Bloom filter rules out most commits without reading trees.
+    bool touchesPath(CommitGraph& history, CommitNode node, const std::string& path) {
+        if (!history.mayHaveChanged(node, path)) {
+            return false;
+        }
+        std::vector<CommitNode> parents;
+        history.parentsOf(node, parents);
+        std::string parentTree = parents.empty() ? "" : history.treeOf(parents[0]);
+        return Tree::lookupPath(objectsDir, history.treeOf(node), path) !=
+               Tree::lookupPath(objectsDir, parentTree, path);
+    }
+
+    // Helper to turn the revisions given to diff into the two commits to compare
+    bool resolveDiffRevisions(const std::vector<std::string>& revisions, std::string& oldCommitHash, std::string& newCommitHash) {
+        std::string oldRef, newRef;
+        bool againstMergeBase = false;
+        if (revisions.size() == 2) {
+            oldRef = revisions[0];
+            newRef = revisions[1];
+        } else if (revisions.size() == 1 && revisions[0].find("..") != std::string::npos) {
+            size_t dotsPos = revisions[0].find("..");
+            againstMergeBase = revisions[0].compare(dotsPos, 3, "...") == 0;
+            oldRef = revisions[0].substr(0, dotsPos);
+            newRef = revisions[0].substr(dotsPos + (againstMergeBase ? 3 : 2));
+            if (oldRef.empty()) oldRef = "HEAD"; // A missing side means HEAD
+            if (newRef.empty()) newRef = "HEAD";
+        } else {
+            std::cerr << "Error: diff needs two commits, or a range such as <a>..<b>." << std::endl;
+            return false;
+        }
+
+        oldCommitHash = resolveCommitRef(oldRef);
+        if (oldCommitHash.empty()) {
+            return false;
+        }
+        newCommitHash = resolveCommitRef(newRef);
+        if (newCommitHash.empty()) {
+            return false;
+        }
+        if (againstMergeBase) {
+            oldCommitHash = graph().findLCA(oldCommitHash, newCommitHash);
+            if (oldCommitHash.empty()) {
+                std::cerr << "Error: '" << oldRef << "' and '" << newRef << "' have no common ancestor." << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Helper to build the full snapshot the index stands for: HEAD with the staged files
+    // replaced and the files marked for removal left out
+    Snapshot indexedSnapshot(const Snapshot& headSnapshot) {
+        Snapshot result;
+        Snapshot none;
+        SnapshotJoin join(headSnapshot, stagingArea->getSnapshot(), none);
+        SnapshotJoin::Row row;
+        while (join.next(row)) {
+            const SnapshotEntry* entry = row.second ? row.second : row.first;
+            if (!entry->id.isNull()) {
+                result.append(row.path, entry->id);
+            }
+        }
+        return result;
+    }
+
+    // Helper to list the files that differ between two snapshots, sorted by path. With
+    // trackedOnly, files that exist only in the new snapshot are not reported.
+    static std::vector<TreeChange> diffSnapshots(const Snapshot& oldSnapshot, const Snapshot& newSnapshot, bool trackedOnly) {
+        std::vector<TreeChange> changes;
+        Snapshot none;
+        SnapshotJoin join(oldSnapshot, newSnapshot, none);
+        SnapshotJoin::Row row;
+        while (join.next(row)) {
+            if (!row.first && !trackedOnly) {
+                changes.push_back({'A', std::string(row.path), "", row.second->id.toString()});
+            } else if (row.first && !row.second) {
+                changes.push_back({'D', std::string(row.path), row.first->id.toString(), ""});
+            } else if (row.first && row.second && row.first->id != row.second->id) {
+                changes.push_back({'M', std::string(row.path), row.first->id.toString(), row.second->id.toString()});
+            }
+        }
+        return changes;
+    }
+
+    // Helper to move the working directory from one tree to another by applying the
+    // changes between them, leaving every other file untouched
+    bool updateWorkingDirectory(const std::vector<TreeChange>& changes) {
+        try {
+            // Deletions first, so a deleted directory can be replaced by a file and vice versa
+            for (const auto& change : changes) {
+                if (change.status != 'D') continue;
+                std::filesystem::path absolutePath = workingDir / change.path;
+                std::filesystem::remove(absolutePath);
+                // Remove directories left empty by the deletion
+                for (std::filesystem::path dir = absolutePath.parent_path();
+                     dir != workingDir && std::filesystem::is_directory(dir) && std::filesystem::is_empty(dir);
+                     dir = dir.parent_path()) {
+                    std::filesystem::remove(dir);
+                }
+            }
+            for (const auto& change : changes) {
+                if (change.status == 'D') continue;
+                std::filesystem::path absolutePath = workingDir / change.path;
+                std::filesystem::create_directories(absolutePath.parent_path()); // Ensure parent directories exist
+                if (!Utils::writeFile(absolutePath.string(), Utils::readFile(Utils::objectPath(objectsDir, change.newHash)))) {
+                    return false;
+                }
+            }
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "Error updating working directory: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
     // Helper to read current HEAD reference
     std::string readHeadRef() {
         if (!std::filesystem::exists(headFile)) {
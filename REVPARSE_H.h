@@ -0,0 +1,127 @@
+#ifndef REVPARSE_H
+#define REVPARSE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include "COMMITGRAPH_H.h"
+
+// A set of commits given on the command line: everything reachable from `include`
+// except what is reachable from `exclude`.
+struct RevRange {
+    std::vector<CommitNode> include;
+    std::vector<CommitNode> exclude;
+};
+
+// This class evaluates revision expressions over the commit graph:
+//   <name>       a name understood by the resolver (HEAD, a branch, a full or short hash)
+//   <rev>~<n>    the n-th first-parent ancestor (~ alone means ~1)
+//   <rev>^<n>    the n-th parent (^ alone means ^1, ^0 is the commit itself)
+// and, for ranges,
+//   A..B         commits reachable from B but not from A (a missing side means HEAD)
+//   A...B        commits reachable from exactly one of A and B
+//   ^A           exclude commits reachable from A
+// Ancestry operators are parent hops in the commit graph, so HEAD~5000 reads no
+// commit objects when the commit-graph file covers the history.
+class RevParser {
+public:
+    using NameResolver = std::function<std::string(const std::string&)>;
+
+    RevParser(CommitGraph& commitGraph, NameResolver nameResolver)
+        : graph(commitGraph), resolveName(std::move(nameResolver)) {}
+
+    // Resolve a single revision to a commit; reports an error and returns false if it
+    // does not name a commit
+    bool resolve(const std::string& rev, CommitNode& node) {
+        size_t operatorPos = rev.find_first_of("~^");
+        std::string name = rev.substr(0, operatorPos);
+        std::string hash = resolveName(name.empty() ? "HEAD" : name);
+        if (hash.empty() || !graph.lookup(hash, node)) {
+            std::cerr << "Error: Reference '" << (name.empty() ? rev : name)
+                      << "' not found. Not a valid branch or commit hash." << std::endl;
+            return false;
+        }
+
+        std::vector<CommitNode> parents;
+        size_t pos = operatorPos;
+        while (pos != std::string::npos && pos < rev.size()) {
+            char op = rev[pos++];
+            size_t digitsEnd = rev.find_first_not_of("0123456789", pos);
+            if (digitsEnd == std::string::npos) digitsEnd = rev.size();
+            if (op != '~' && op != '^') {
+                std::cerr << "Error: Invalid revision '" << rev << "'." << std::endl;
+                return false;
+            }
+            unsigned long count = 1;
+            if (digitsEnd > pos) {
+                try {
+                    count = std::stoul(rev.substr(pos, digitsEnd - pos));
+                } catch (const std::exception&) {
+                    std::cerr << "Error: Invalid revision '" << rev << "'." << std::endl;
+                    return false;
+                }
+            }
+            pos = digitsEnd;
+
+            if (op == '~') {
+                for (unsigned long i = 0; i < count; ++i) {
+                    graph.parentsOf(node, parents);
+                    if (parents.empty()) {
+                        std::cerr << "Error: Revision '" << rev << "' goes past the root commit." << std::endl;
+                        return false;
+                    }
+                    node = parents[0];
+                }
+            } else if (count > 0) {
+                graph.parentsOf(node, parents);
+                if (count > parents.size()) {
+                    std::cerr << "Error: Revision '" << rev << "' names a parent that does not exist." << std::endl;
+                    return false;
+                }
+                node = parents[count - 1];
+            }
+        }
+        return true;
+    }
+
+    // Add a revision argument ("A", "^A", "A..B" or "A...B") to a range
+    bool addToRange(const std::string& expr, RevRange& range) {
+        size_t dotsPos = expr.find("..");
+        if (dotsPos == std::string::npos) {
+            bool exclude = !expr.empty() && expr[0] == '^';
+            CommitNode node;
+            if (!resolve(exclude ? expr.substr(1) : expr, node)) {
+                return false;
+            }
+            (exclude ? range.exclude : range.include).push_back(node);
+            return true;
+        }
+
+        bool symmetric = expr.compare(dotsPos, 3, "...") == 0;
+        std::string left = expr.substr(0, dotsPos);
+        std::string right = expr.substr(dotsPos + (symmetric ? 3 : 2));
+        CommitNode leftNode, rightNode;
+        if (!resolve(left.empty() ? "HEAD" : left, leftNode) ||
+            !resolve(right.empty() ? "HEAD" : right, rightNode)) {
+            return false;
+        }
+        range.include.push_back(rightNode);
+        if (!symmetric) {
+            range.exclude.push_back(leftNode);
+            return true;
+        }
+        // Commits reachable from both sides are exactly those below their merge bases
+        range.include.push_back(leftNode);
+        for (CommitNode base : graph.findMergeBases(leftNode, rightNode)) {
+            range.exclude.push_back(base);
+        }
+        return true;
+    }
+
+private:
+    CommitGraph& graph;
+    NameResolver resolveName;
+};
+
+#endif // REVPARSE_H
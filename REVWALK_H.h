@@ -0,0 +1,141 @@
+#ifndef REVWALK_H
+#define REVWALK_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "COMMITGRAPH_H.h"
+
+// This class streams the commits reachable from a set of starting commits, one at a
+// time, without collecting the history first: a heap holds only the current frontier,
+// so printing the first N commits of a huge history costs about N steps.
+//
+// Commits reachable from a hidden commit (the "A" in A..B) are left out. Hidden commits
+// share the heap with the visible ones and pass their mark on to their parents as they
+// are popped. A commit's clock may be skewed, so date order alone does not guarantee that
+// every child that could hide a commit is popped first: before a visible commit is
+// produced, the queued hidden commits with a higher generation number (the only ones
+// that can reach it) are processed out of turn. The walk ends as soon as no visible
+// commit is queued, so a range costs about the commits between its ends, not the
+// history below them.
+class RevWalker {
+public:
+    enum class Order {
+        Date, // Latest commit time first (the default log order)
+        Topo  // Highest generation first: every commit is shown before its parents
+    };
+
+    RevWalker(CommitGraph& commitGraph, Order walkOrder = Order::Date, bool firstParentOnly = false)
+        : graph(commitGraph), order(walkOrder), firstParent(firstParentOnly) {}
+
+    // Add a starting commit (duplicates are ignored)
+    void push(CommitNode node) { enqueue(node, false); }
+
+    // Leave out a commit and everything reachable from it
+    void hide(CommitNode node) { enqueue(node, true); }
+
+    // Produce the next commit; returns false when the walk is complete
+    bool next(CommitNode& node) {
+        while (visibleQueued > 0) {
+            std::pop_heap(queue.begin(), queue.end(), [this](CommitNode a, CommitNode b) { return before(b, a); });
+            CommitNode current = queue.back();
+            queue.pop_back();
+            if (!(flags[current] & kQueued)) {
+                continue; // Already processed out of turn as a hidden commit
+            }
+            flags[current] &= ~kQueued;
+            if (!(flags[current] & kHidden)) {
+                --visibleQueued;
+                processHiddenAbove(graph.generationOf(current)); // May hide the current commit
+            }
+            bool hidden = flags[current] & kHidden;
+            enqueueParents(current, hidden);
+            if (!hidden) {
+                node = current;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static constexpr uint8_t kSeen = 1;   // Has been queued at some point
+    static constexpr uint8_t kQueued = 2; // Currently in the heap
+    static constexpr uint8_t kHidden = 4; // Reachable from a hidden commit
+
+    CommitGraph& graph;
+    Order order;
+    bool firstParent;
+    std::vector<CommitNode> queue; // Heap of commits seen but not yet produced
+    std::vector<CommitNode> hiddenQueue; // Heap of the hidden ones, highest generation first
+    std::unordered_map<CommitNode, uint8_t> flags;
+    size_t visibleQueued = 0; // Queued commits that are not hidden
+    std::vector<CommitNode> parents;
+
+    void enqueueParents(CommitNode node, bool hidden) {
+        graph.parentsOf(node, parents);
+        if (firstParent && parents.size() > 1) {
+            parents.resize(1);
+        }
+        for (CommitNode parent : parents) {
+            enqueue(parent, hidden);
+        }
+    }
+
+    // Process the queued hidden commits with a generation above the given one, and the
+    // hidden parents they queue in turn. They stay in the main heap and are skipped there.
+    void processHiddenAbove(uint32_t generation) {
+        auto lower = [this](CommitNode a, CommitNode b) { return graph.generationOf(a) < graph.generationOf(b); };
+        while (!hiddenQueue.empty() && graph.generationOf(hiddenQueue.front()) > generation) {
+            std::pop_heap(hiddenQueue.begin(), hiddenQueue.end(), lower);
+            CommitNode hidden = hiddenQueue.back();
+            hiddenQueue.pop_back();
+            if (flags[hidden] & kQueued) {
+                flags[hidden] &= ~kQueued;
+                enqueueParents(hidden, true);
+            }
+        }
+    }
+
+    void enqueue(CommitNode node, bool hidden) {
+        uint8_t& nodeFlags = flags[node];
+        if (nodeFlags & kSeen) {
+            if (hidden && !(nodeFlags & kHidden)) {
+                // Reached again from a hidden commit: still queued commits become hidden
+                // and pass that on when popped
+                nodeFlags |= kHidden;
+                if (nodeFlags & kQueued) {
+                    --visibleQueued;
+                    pushHidden(node);
+                }
+            }
+            return;
+        }
+        nodeFlags = kSeen | kQueued | (hidden ? kHidden : 0);
+        if (hidden) {
+            pushHidden(node);
+        } else {
+            ++visibleQueued;
+        }
+        queue.push_back(node);
+        std::push_heap(queue.begin(), queue.end(), [this](CommitNode a, CommitNode b) { return before(b, a); });
+    }
+
+    void pushHidden(CommitNode node) {
+        hiddenQueue.push_back(node);
+        std::push_heap(hiddenQueue.begin(), hiddenQueue.end(),
+                       [this](CommitNode a, CommitNode b) { return graph.generationOf(a) < graph.generationOf(b); });
+    }
+
+    // Whether a should be produced before b. Date order assumes parents are not newer
+    // than their children (no clock skew); ties fall back to generation order.
+    bool before(CommitNode a, CommitNode b) {
+        if (order == Order::Date) {
+            int64_t timeA = graph.timeOf(a), timeB = graph.timeOf(b);
+            if (timeA != timeB) return timeA > timeB;
+        }
+        return graph.newer(a, b);
+    }
+};
+
+#endif // REVWALK_H
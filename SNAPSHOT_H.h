@@ -0,0 +1,129 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "OBJECTID_H.h"
+#include "PATHPOOL_H.h"
+
+// One file of a snapshot.
+struct SnapshotEntry {
+    std::string_view path;   // Path relative to the repository root, interned in PathPool::global()
+    ObjectId id;             // Blob hash (null when the entry only records a removal)
+    uint32_t mode = 0100644; // Regular file; MiniGit does not track other modes yet
+};
+
+// This class is a flat snapshot of files kept as one contiguous vector sorted by path.
+// Lookups are binary searches, and walking several snapshots side by side is a linear
+// merge-join (see SnapshotJoin) with a deterministic, sorted output order.
+class Snapshot {
+private:
+    std::vector<SnapshotEntry> entries;
+
+public:
+    using const_iterator = std::vector<SnapshotEntry>::const_iterator;
+
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() { entries.clear(); }
+    void reserve(size_t n) { entries.reserve(n); }
+
+    // Find an entry by path (binary search)
+    const SnapshotEntry* find(std::string_view path) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), path,
+                                   [](const SnapshotEntry& e, std::string_view p) { return e.path < p; });
+        if (it != entries.end() && it->path == path) {
+            return &*it;
+        }
+        return nullptr;
+    }
+
+    bool contains(std::string_view path) const { return find(path) != nullptr; }
+
+    // Append an entry. Entries appended in sorted order (e.g. from a tree walk) need no
+    // further work; otherwise call sortByPath() once after the last append.
+    // The path is interned, so equal paths across snapshots share one copy.
+    void append(std::string_view path, const ObjectId& id) {
+        entries.push_back({PathPool::global().intern(path), id});
+    }
+
+    // Insert or replace the entry for a path, keeping the entries sorted
+    void set(std::string_view path, const ObjectId& id) {
+        auto it = std::lower_bound(entries.begin(), entries.end(), path,
+                                   [](const SnapshotEntry& e, std::string_view p) { return e.path < p; });
+        if (it != entries.end() && it->path == path) {
+            it->id = id;
+        } else {
+            entries.insert(it, {PathPool::global().intern(path), id});
+        }
+    }
+
+    // Remove the entry for a path, if there is one
+    void remove(std::string_view path) {
+        auto it = std::lower_bound(entries.begin(), entries.end(), path,
+                                   [](const SnapshotEntry& e, std::string_view p) { return e.path < p; });
+        if (it != entries.end() && it->path == path) {
+            entries.erase(it);
+        }
+    }
+
+    // Sort the entries by path; for duplicate paths the last appended entry wins
+    void sortByPath() {
+        auto byPath = [](const SnapshotEntry& a, const SnapshotEntry& b) { return a.path < b.path; };
+        if (!std::is_sorted(entries.begin(), entries.end(), byPath)) {
+            std::stable_sort(entries.begin(), entries.end(), byPath);
+        }
+        auto last = std::unique(entries.rbegin(), entries.rend(),
+                                [](const SnapshotEntry& a, const SnapshotEntry& b) { return a.path == b.path; });
+        entries.erase(entries.begin(), last.base());
+    }
+};
+
+// This class merge-joins three snapshots sorted by path. Each step yields one path from
+// the union of the three together with its entry in each snapshot (nullptr if absent),
+// so a caller visits every path exactly once without any hash lookups.
+class SnapshotJoin {
+public:
+    struct Row {
+        std::string_view path;
+        const SnapshotEntry* first;
+        const SnapshotEntry* second;
+        const SnapshotEntry* third;
+    };
+
+    SnapshotJoin(const Snapshot& first, const Snapshot& second, const Snapshot& third)
+        : a(first.begin()), aEnd(first.end()),
+          b(second.begin()), bEnd(second.end()),
+          c(third.begin()), cEnd(third.end()) {}
+
+    // Advance to the next path; returns false when all three snapshots are exhausted
+    bool next(Row& row) {
+        const std::string_view* smallest = nullptr;
+        if (a != aEnd) smallest = &a->path;
+        if (b != bEnd && (!smallest || b->path < *smallest)) smallest = &b->path;
+        if (c != cEnd && (!smallest || c->path < *smallest)) smallest = &c->path;
+        if (!smallest) {
+            return false;
+        }
+
+        // Interned paths are equal exactly when they share storage
+        row.path = *smallest;
+        row.first = (a != aEnd && a->path.data() == row.path.data()) ? &*a : nullptr;
+        row.second = (b != bEnd && b->path.data() == row.path.data()) ? &*b : nullptr;
+        row.third = (c != cEnd && c->path.data() == row.path.data()) ? &*c : nullptr;
+        if (row.first) ++a;
+        if (row.second) ++b;
+        if (row.third) ++c;
+        return true;
+    }
+
+private:
+    Snapshot::const_iterator a, aEnd, b, bEnd, c, cEnd;
+};
+
+#endif // SNAPSHOT_H
@@ -2,18 +2,22 @@
 #define STAGINGAREA_H
 
 #include <string>
-#include <unordered_map>
 #include <fstream>
+#include <sstream>
+#include <iostream>
 #include <filesystem> // Required for std::filesystem::path
 
 #include "Utils.h" // Your comprehensive utility functions
+#include "SNAPSHOT_H.h"
+#include "WORKTREE_H.h"
 
 class StagingArea {
 private:
     std::filesystem::path minigitDir;
     std::filesystem::path indexPath; // Path to the index file
-    std::unordered_map<std::string, std::string> stagedFiles; // filepath -> blob hash
-    std::set<std::string> removedFiles; // files explicitly marked for removal
+    // Sorted index entries with interned paths: staged files carry their blob hash,
+    // files explicitly marked for removal carry a null id
+    Snapshot entries;
 
 public:
     StagingArea(const std::filesystem::path& baseDir)
@@ -42,17 +46,23 @@ public:
         // Compute hash and add to stagedFiles
         std::string fileContent = Utils::readFile(absolutePath.string());
         std::string blobHash = Utils::computeHash(fileContent);
-        stagedFiles[relativePath.string()] = blobHash; // This line and the next are correct.
-        removedFiles.erase(relativePath.string()); // If a file was removed and then re-added
+        entries.set(relativePath.string(), ObjectId(blobHash)); // Also clears a previous removal mark
         saveIndex();
         return true;
     }
 
+    // Stage a blob that is already in the object store (or, with a null id, a removal)
+    // without reading the working directory; call saveIndex() once after a batch
+    void stage(std::string_view filepath, const ObjectId& id) {
+        entries.set(filepath, id);
+    }
+
     // Mark a file for removal from the staging area
     bool removeFile(const std::string& filepath) {
         // Check if the file is currently staged
-        bool wasStaged = stagedFiles.erase(filepath);
-        removedFiles.insert(filepath); // Mark for removal
+        const SnapshotEntry* entry = entries.find(filepath);
+        bool wasStaged = entry && !entry->id.isNull();
+        entries.set(filepath, ObjectId()); // Mark for removal
         saveIndex();
         std::cout << "Removed " << filepath << std::endl;
         return wasStaged; // Return true if it was explicitly staged
@@ -60,8 +70,7 @@ public:
 
     // Load the index from the file
     void loadIndex() {
-        stagedFiles.clear();
-        removedFiles.clear();
+        entries.clear();
         if (!std::filesystem::exists(indexPath)) {
             return; // No index file, nothing to load
         }
@@ -82,28 +91,30 @@ public:
                 if (secondSpace == std::string::npos) continue;
                 std::string hash = data.substr(0, secondSpace);
                 std::string filepath = data.substr(secondSpace + 1);
-                stagedFiles[filepath] = hash;
+                entries.append(filepath, ObjectId(hash));
             } else if (type == "removed") {
-                removedFiles.insert(data);
+                entries.append(data, ObjectId());
             }
         }
+        entries.sortByPath(); // A no-op check for indexes written by saveIndex()
     }
 
     // Save the current state of the staging area to the index file
     bool saveIndex() {
         std::stringstream ss;
-        for (const auto& pair : stagedFiles) {
-            ss << "staged " << pair.second << " " << pair.first << "\n";
-        }
-        for (const auto& filepath : removedFiles) {
-            ss << "removed " << filepath << "\n";
+        for (const auto& entry : entries) {
+            if (entry.id.isNull()) {
+                ss << "removed " << entry.path << "\n";
+            } else {
+                ss << "staged " << entry.id.toString() << " " << entry.path << "\n";
+            }
         }
         return Utils::writeFile(indexPath.string(), ss.str());
     }
 
     // Check if the staging area is empty
     bool isEmpty() const {
-        return stagedFiles.empty() && removedFiles.empty();
+        return entries.empty();
     }
 
     // Get the path to the staging area's index file
@@ -111,20 +122,14 @@ public:
         return indexPath;
     }
 
-    // Get a const reference to staged files
-    const std::unordered_map<std::string, std::string>& getStagedFiles() const {
-        return stagedFiles;
-    }
-
-    // Get a const reference to removed files
-    const std::set<std::string>& getRemovedFiles() const {
-        return removedFiles;
+    // Get the index as a sorted snapshot
+    const Snapshot& getSnapshot() const {
+        return entries;
     }
 
     // Clear the staging area (after a commit)
     void clear() {
-        stagedFiles.clear();
-        removedFiles.clear();
+        entries.clear();
     }
     
     // Check for unstaged changes in the working directory
@@ -132,51 +137,36 @@ public:
     // and also against the staged files.
     bool hasUnstagedChanges(const std::filesystem::path& workingDir, 
                             const std::filesystem::path& objectsDir,
-                            const std::unordered_map<std::string, std::string>& headSnapshot) {
-        
-        // 1. Check for modified/deleted files not staged
-        // Iterate through headSnapshot to find deleted/modified files
-        for (const auto& [filepath, headHash] : headSnapshot) {
-            std::filesystem::path absolutePath = workingDir / filepath;
-            bool inStaged = stagedFiles.count(filepath);
-            std::string stagedHash = inStaged ? stagedFiles.at(filepath) : "";
-
-            if (!std::filesystem::exists(absolutePath)) {
+                            const Snapshot& headSnapshot) {
+        Snapshot workingDirSnapshot = WorkingTree::scan(workingDir);
+
+        SnapshotJoin join(headSnapshot, entries, workingDirSnapshot);
+        SnapshotJoin::Row row;
+        while (join.next(row)) {
+            const SnapshotEntry* head = row.first;
+            const SnapshotEntry* index = row.second;
+            const SnapshotEntry* workingDirFile = row.third;
+            bool inStaged = index && !index->id.isNull();
+            bool inRemoved = index && index->id.isNull();
+
+            if (!workingDirFile) {
                 // File deleted in working directory
-                if (!removedFiles.count(filepath) && (!inStaged || stagedHash != headHash)) {
+                if (head && !inRemoved && (!inStaged || index->id != head->id)) {
                     // Not explicitly removed, and not staged for deletion OR staged but content is different from HEAD
                     return true; // Unstaged deletion
                 }
-            } else {
-                // File exists in working directory, check content
-                std::string workingDirContent = Utils::readFile(absolutePath.string());
-                std::string workingDirHash = Utils::computeHash(workingDirContent);
-
-                if (inStaged) {
-                    // File is staged, check if working directory has further modifications
-                    if (stagedHash != workingDirHash) {
-                        return true; // Staged but modified in WD
-                    }
-                } else {
-                    // File not staged, check if working directory modified compared to HEAD
-                    if (headHash != workingDirHash) {
-                        return true; // Unstaged modification
-                    }
+            } else if (inStaged) {
+                // File is staged, check if working directory has further modifications
+                if (index->id != workingDirFile->id) {
+                    return true; // Staged but modified in WD
                 }
-            }
-        }
-
-        // 2. Check for newly created untracked files (not in headSnapshot and not in stagedFiles)
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(workingDir)) {
-            if (entry.is_regular_file()) {
-                std::filesystem::path relativePath = std::filesystem::relative(entry.path(), workingDir);
-                if (relativePath.string().rfind(".minigit", 0) != 0 && relativePath.string().rfind(".git", 0) != 0) { // Ignore .minigit and .git directories
-                    if (relativePath.string() == ".gitignore") continue; // Ignore .gitignore itself
-
-                    if (!headSnapshot.count(relativePath.string()) && !stagedFiles.count(relativePath.string())) {
-                        return true; // Untracked file
-                    }
+            } else if (head) {
+                // File not staged, check if working directory modified compared to HEAD
+                if (head->id != workingDirFile->id) {
+                    return true; // Unstaged modification
                 }
+            } else if (!WorkingTree::ignoredWhenUntracked(row.path)) {
+                return true; // Untracked file (not in HEAD and not staged)
             }
         }
 
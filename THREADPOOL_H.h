@@ -0,0 +1,108 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// This class keeps a fixed set of worker threads for running many independent tasks.
+// Tasks are numbered 0..count-1 and handed out one at a time from a shared counter, so
+// slow tasks do not hold up a whole batch. Each task should write only its own result
+// slot; results then come out in task order no matter which thread ran which task.
+// The calling thread works along with the pool while it waits.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = defaultThreadCount()) {
+        for (size_t i = 1; i < threadCount; ++i) { // The caller is the remaining thread
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // One thread per hardware thread (at least one)
+    static size_t defaultThreadCount() {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads == 0 ? 1 : hardwareThreads;
+    }
+
+    // Run task(i) for every i in [0, count) and wait until all of them have finished
+    void parallelFor(size_t count, const std::function<void(size_t)>& task) {
+        if (workers.empty() || count < 2) {
+            for (size_t i = 0; i < count; ++i) {
+                task(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            jobCount = count;
+            nextTask = 0;
+            busyWorkers = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        runTasks(task, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;     // A new batch was posted (or the pool is stopping)
+    std::condition_variable finished; // The last worker finished the current batch
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextTask{0};
+    size_t busyWorkers = 0;
+    uint64_t generation = 0; // Number of batches posted so far
+    bool stopping = false;
+
+    void runTasks(const std::function<void(size_t)>& task, size_t count) {
+        for (size_t i = nextTask++; i < count; i = nextTask++) {
+            task(i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            const std::function<void(size_t)>& task = *job;
+            size_t count = jobCount;
+            lock.unlock();
+            runTasks(task, count);
+            lock.lock();
+            if (--busyWorkers == 0) {
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+#endif // THREADPOOL_H
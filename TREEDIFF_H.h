@@ -0,0 +1,108 @@
+#ifndef TREEDIFF_H
+#define TREEDIFF_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "TREE_H.h"
+
+// A single file-level difference between two trees.
+struct TreeChange {
+    char status;          // 'A' (added), 'M' (modified) or 'D' (deleted)
+    std::string path;     // Full path relative to the repository root
+    std::string oldHash;  // Blob hash in the old tree ("" if added)
+    std::string newHash;  // Blob hash in the new tree ("" if deleted)
+};
+
+// This class compares two tree objects. Both trees are walked in parallel in sorted
+// name order, and any subtree whose hash is identical on both sides is skipped without
+// being loaded, so comparing nearly-identical commits costs O(changes), not O(files).
+class TreeDiff {
+public:
+    // Compare two root trees. An empty hash stands for an empty tree.
+    // Changes are returned sorted by path.
+    static std::vector<TreeChange> diff(const std::filesystem::path& objectsPath,
+                                        const std::string& oldTreeHash,
+                                        const std::string& newTreeHash) {
+        std::vector<TreeChange> changes;
+        diffTrees(objectsPath, oldTreeHash, newTreeHash, "", changes);
+        return changes;
+    }
+
+private:
+    static Tree loadOrEmpty(const std::filesystem::path& objectsPath, const std::string& treeHash) {
+        return treeHash.empty() ? Tree() : Tree::loadFromObjectStore(objectsPath, treeHash);
+    }
+
+    static void diffTrees(const std::filesystem::path& objectsPath,
+                          const std::string& oldTreeHash,
+                          const std::string& newTreeHash,
+                          const std::string& prefix,
+                          std::vector<TreeChange>& changes) {
+        if (oldTreeHash == newTreeHash) {
+            return; // Identical subtree: nothing below it can differ
+        }
+
+        Tree oldTree = loadOrEmpty(objectsPath, oldTreeHash);
+        Tree newTree = loadOrEmpty(objectsPath, newTreeHash);
+        const auto& oldEntries = oldTree.getEntries();
+        const auto& newEntries = newTree.getEntries();
+
+        size_t i = 0, j = 0;
+        while (i < oldEntries.size() || j < newEntries.size()) {
+            int cmp;
+            if (i == oldEntries.size()) {
+                cmp = 1;
+            } else if (j == newEntries.size()) {
+                cmp = -1;
+            } else {
+                cmp = Tree::compareNames(oldEntries[i].name, oldEntries[i].isTree,
+                                         newEntries[j].name, newEntries[j].isTree);
+            }
+
+            if (cmp < 0) {
+                // Only in the old tree: deleted
+                addSide(objectsPath, oldEntries[i], prefix, 'D', changes);
+                ++i;
+            } else if (cmp > 0) {
+                // Only in the new tree: added
+                addSide(objectsPath, newEntries[j], prefix, 'A', changes);
+                ++j;
+            } else {
+                // Same name and same type (a file and a directory never compare equal)
+                const TreeEntry& oldEntry = oldEntries[i];
+                const TreeEntry& newEntry = newEntries[j];
+                if (oldEntry.isTree) {
+                    diffTrees(objectsPath, oldEntry.hash, newEntry.hash, prefix + oldEntry.name + "/", changes);
+                } else if (oldEntry.hash != newEntry.hash) {
+                    changes.push_back({'M', prefix + oldEntry.name, oldEntry.hash, newEntry.hash});
+                }
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    // Report an entry that exists on one side only; subtrees are expanded file by file
+    static void addSide(const std::filesystem::path& objectsPath,
+                        const TreeEntry& entry,
+                        const std::string& prefix,
+                        char status,
+                        std::vector<TreeChange>& changes) {
+        if (!entry.isTree) {
+            if (status == 'A') {
+                changes.push_back({'A', prefix + entry.name, "", entry.hash});
+            } else {
+                changes.push_back({'D', prefix + entry.name, entry.hash, ""});
+            }
+            return;
+        }
+        if (status == 'A') {
+            diffTrees(objectsPath, "", entry.hash, prefix + entry.name + "/", changes);
+        } else {
+            diffTrees(objectsPath, entry.hash, "", prefix + entry.name + "/", changes);
+        }
+    }
+};
+
+#endif // TREEDIFF_H
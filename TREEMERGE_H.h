@@ -0,0 +1,362 @@
+#ifndef TREEMERGE_H
+#define TREEMERGE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <filesystem>
+#include <memory>
+#include <algorithm>
+#include "Utils.h"
+#include "TREE_H.h"
+#include "TREEDIFF_H.h"
+#include "SNAPSHOT_H.h"
+#include "COMMITGRAPH_H.h"
+#include "LINEMERGE_H.h"
+#include "RENAMES_H.h"
+#include "THREADPOOL_H.h"
+#include "BINARY_H.h"
+
+// A path a merge could not resolve
+struct MergeConflict {
+    std::string path;
+    std::string kind; // "content" or "modify/delete"
+    std::string hash; // Blob with the conflicted content, markers around what differs (a binary file is left as is)
+    std::string baseHash, oursHash, theirsHash; // Each side's blob ("" where the file does not exist)
+};
+
+// Outcome of merging two trees
+struct TreeMergeResult {
+    std::string tree;                     // Merged root tree; conflicted files hold their markers
+    std::vector<TreeChange> changes;      // Clean changes relative to "ours", sorted by path
+    std::vector<MergeConflict> conflicts; // Sorted by path
+    std::vector<std::string> messages;    // "Auto-merging ..." and "CONFLICT ..." lines in path order
+    bool failed = false;                  // An object could not be written
+};
+
+// This class merges trees in the object store alone: it reads blobs and trees, writes the
+// merged blobs and trees, and never touches a working directory. Callers decide what to do
+// with the result (update a checkout, make a commit, or just report conflicts).
+//
+// Only paths changed on at least one side since the base are looked at. A file moved on
+// one side is followed to its new path on the other (see RenameDetector), and files both
+// sides changed are line-merged, on a thread pool when there are enough of them. Binary files are never line-merged:
+// markers spliced into their bytes would corrupt them, so one side's version is taken
+// whole (ours, and a conflict, unless a side is favored).
+//
+// Commits with several best merge bases (criss-cross histories) are merged recursively:
+// the bases are first merged with each other into a virtual ancestor tree, which then
+// serves as the base. Using any single base instead would replay changes the other bases
+// already share and report conflicts that are not real. Every tree merge is cached by its
+// (base, ours, theirs) trees, so inner merges reached more than once are done once.
+class TreeMerger {
+public:
+    // File merges use up to `threads` threads, the calling thread included
+    TreeMerger(const std::filesystem::path& objectsPath, CommitGraph& commitGraph,
+               size_t threads = ThreadPool::defaultThreadCount())
+        : objectsDir(objectsPath), graph(commitGraph), threadCount(threads) {}
+
+    // Merge the commit theirs into the commit ours
+    TreeMergeResult mergeCommits(CommitNode ours, CommitNode theirs,
+                                 const std::string& oursLabel, const std::string& theirsLabel,
+                                 MergeFavor favor = MergeFavor::None) {
+        std::string baseTree;
+        if (!mergeBaseTree(ours, theirs, baseTree)) {
+            TreeMergeResult result;
+            result.failed = true;
+            return result;
+        }
+        return mergeTrees(baseTree, graph.treeOf(ours), graph.treeOf(theirs), oursLabel, theirsLabel, favor);
+    }
+
+    // Three-way merge of trees ("" stands for an empty tree). A favored side wins every
+    // region (or binary file) both sides changed differently instead of a conflict.
+    const TreeMergeResult& mergeTrees(const std::string& baseTree, const std::string& oursTree, const std::string& theirsTree,
+                                      const std::string& oursLabel, const std::string& theirsLabel,
+                                      MergeFavor favor = MergeFavor::None) {
+        // Labels end up in conflict markers, so they are part of the key
+        std::string key = baseTree + '\n' + oursTree + '\n' + theirsTree + '\n' + oursLabel + '\n' + theirsLabel +
+                          '\n' + std::to_string(static_cast<int>(favor));
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+            it = cache.emplace(key, computeMerge(baseTree, oursTree, theirsTree, oursLabel, theirsLabel, favor)).first;
+        }
+        return it->second;
+    }
+
+    // Find the base tree for merging two commits: the tree of their merge base, or with
+    // several merge bases their virtual ancestor ("" if the histories are unrelated).
+    // Returns false if a virtual ancestor could not be written.
+    bool mergeBaseTree(CommitNode a, CommitNode b, std::string& tree) {
+        return virtualAncestorTree(graph.findMergeBases(a, b), tree);
+    }
+
+    // Find the base tree for merging a commit into a merge of several commits (e.g. the
+    // merge bases folded so far, or the branches of an octopus merge): the best common
+    // ancestors of the commit and any of them, as one virtual ancestor if several
+    bool mergeBaseTree(const std::vector<CommitNode>& merged, CommitNode other, std::string& tree) {
+        return virtualAncestorTree(graph.findMergeBases(merged, other), tree);
+    }
+
+    // Find the tree standing for a set of merge bases: the tree of a single base, or all of
+    // them merged with each other ("" for none). Returns false if a merge could not be written.
+    bool virtualAncestorTree(const std::vector<CommitNode>& bases, std::string& tree) {
+        tree = bases.empty() ? "" : graph.treeOf(bases[0]);
+        for (size_t i = 1; i < bases.size(); ++i) {
+            // Fold the next base into the virtual ancestor. The virtual ancestor stands for
+            // all bases folded so far, so its base with the next one comes from all of them,
+            // not just the last. Conflicts stay in the virtual tree as markers, like any
+            // other difference.
+            std::string innerBase;
+            if (!mergeBaseTree(std::vector<CommitNode>(bases.begin(), bases.begin() + i), bases[i], innerBase)) {
+                return false;
+            }
+            const TreeMergeResult& virtualMerge = mergeTrees(innerBase, tree, graph.treeOf(bases[i]),
+                                                             "Temporary merge branch 1", "Temporary merge branch 2");
+            if (virtualMerge.failed) {
+                return false;
+            }
+            tree = virtualMerge.tree;
+        }
+        return true;
+    }
+
+private:
+    // A path both sides changed differently, and the outcome of merging it
+    struct FileMerge {
+        std::string path;
+        ObjectId base, ours, theirs; // Null where the file does not exist
+        std::string mergedHash;      // Merged blob (with conflict markers if conflict is set and the file is text)
+        bool conflict = false;
+        bool binary = false;         // One of the versions is binary, so it was not line-merged
+        bool failed = false;         // The merged blob could not be written
+    };
+
+    // Fewer files than this are merged on the calling thread: waking the pool would cost
+    // more than it saves
+    static constexpr size_t kMinParallelFiles = 8;
+
+    std::filesystem::path objectsDir;
+    CommitGraph& graph;
+    size_t threadCount;
+    std::unique_ptr<ThreadPool> pool; // Started on first use, shared by all merges
+    std::unordered_map<std::string, TreeMergeResult> cache; // See mergeTrees()
+
+    TreeMergeResult computeMerge(const std::string& baseTree, const std::string& oursTree, const std::string& theirsTree,
+                                 const std::string& oursLabel, const std::string& theirsLabel, MergeFavor favor) {
+        TreeMergeResult result;
+        std::vector<TreeChange> oursChanges = TreeDiff::diff(objectsDir, baseTree, oursTree);
+        std::vector<TreeChange> theirsChanges = TreeDiff::diff(objectsDir, baseTree, theirsTree);
+
+        // The base, ours and theirs snapshots are restricted to the changed paths
+        Snapshot baseSnapshot;
+        for (const auto* changes : {&oursChanges, &theirsChanges}) {
+            for (const auto& change : *changes) {
+                if (!change.oldHash.empty()) {
+                    baseSnapshot.append(change.path, ObjectId(change.oldHash));
+                }
+            }
+        }
+        baseSnapshot.sortByPath();
+        Snapshot oursSnapshot = applyTreeChanges(baseSnapshot, oursChanges);
+        Snapshot theirsSnapshot = applyTreeChanges(baseSnapshot, theirsChanges);
+
+        // Changes from theirs to apply on top of ours (an empty hash deletes the file)
+        std::map<std::string, std::string> changesToApply;
+
+        // A file moved on one side is looked for at its new path on the other side too,
+        // so edits made to it under its old name are merged into the moved file
+        auto readObject = [this](const std::string&, const std::string& hash) {
+            return Utils::readFile(Utils::objectPath(objectsDir, hash));
+        };
+        std::vector<RenamePair> oursRenames = RenameDetector::detect(oursChanges, readObject, readObject);
+        std::vector<RenamePair> theirsRenames = RenameDetector::detect(theirsChanges, readObject, readObject);
+        std::unordered_set<std::string> oursMoved, theirsMoved;
+        for (const auto& rename : oursRenames) oursMoved.insert(rename.oldPath);
+        for (const auto& rename : theirsRenames) theirsMoved.insert(rename.oldPath);
+        for (const auto& rename : oursRenames) {
+            if (!theirsMoved.count(rename.oldPath)) { // Moved on both sides: left as two separate files
+                followRename(rename, baseSnapshot, theirsSnapshot);
+            }
+        }
+        for (const auto& rename : theirsRenames) {
+            if (!oursMoved.count(rename.oldPath) && followRename(rename, baseSnapshot, oursSnapshot)) {
+                changesToApply[rename.oldPath] = ""; // Ours still has the file at its old path
+            }
+        }
+
+        std::vector<FileMerge> fileMerges; // Paths changed differently on both sides
+        SnapshotJoin join(baseSnapshot, oursSnapshot, theirsSnapshot);
+        SnapshotJoin::Row row;
+        while (join.next(row)) {
+            ObjectId baseId = row.first ? row.first->id : ObjectId();
+            ObjectId oursId = row.second ? row.second->id : ObjectId();
+            ObjectId theirsId = row.third ? row.third->id : ObjectId();
+
+            if (oursId == theirsId) {
+                continue; // Both sides have the same version, no conflict, use it
+            } else if (baseId == oursId) {
+                // Ours didn't change, but theirs did (added, modified or deleted)
+                changesToApply[std::string(row.path)] = theirsId.isNull() ? "" : theirsId.toString();
+                continue;
+            } else if (baseId == theirsId) {
+                continue; // Theirs didn't change, ours is already in place
+            }
+
+            // Both changed differently, or one changed and other deleted: decided below
+            fileMerges.push_back({std::string(row.path), baseId, oursId, theirsId, "", false, false, false});
+        }
+
+        // Files are merged independently of each other, so many of them are spread over
+        // the thread pool; messages and results are then taken in path order, as if merged
+        // one by one
+        std::mutex objectsMutex;
+        std::unordered_set<std::string> writtenObjects; // Merged blobs claimed by a thread
+        auto mergeOne = [&](size_t i) {
+            mergeFile(fileMerges[i], oursLabel, theirsLabel, favor, objectsMutex, writtenObjects);
+        };
+        if (threadCount > 1 && fileMerges.size() >= kMinParallelFiles) {
+            if (!pool) {
+                pool = std::make_unique<ThreadPool>(threadCount);
+            }
+            pool->parallelFor(fileMerges.size(), mergeOne);
+        } else {
+            for (size_t i = 0; i < fileMerges.size(); ++i) {
+                mergeOne(i);
+            }
+        }
+        std::unordered_set<std::string> conflictPaths;
+        for (const auto& file : fileMerges) {
+            bool modifyDelete = file.ours.isNull() || file.theirs.isNull();
+            if (!modifyDelete) {
+                result.messages.push_back("Auto-merging " + file.path);
+            }
+            if (file.failed) {
+                result.failed = true;
+                result.messages.push_back("Error: Could not write merged blob for " + file.path);
+                continue;
+            }
+            changesToApply[file.path] = file.mergedHash;
+            if (file.conflict && file.binary && !modifyDelete) {
+                result.messages.push_back("warning: Cannot merge binary files: " + file.path +
+                                          " (" + oursLabel + " vs. " + theirsLabel + ")");
+            }
+            if (file.conflict) {
+                std::string kind = modifyDelete ? "modify/delete" : "content";
+                result.conflicts.push_back({file.path, kind, file.mergedHash, hashOrEmpty(file.base),
+                                            hashOrEmpty(file.ours), hashOrEmpty(file.theirs)});
+                result.messages.push_back("CONFLICT (" + kind + "): Merge conflict in " + file.path);
+                conflictPaths.insert(file.path);
+            }
+        }
+
+        for (const auto& [filepath, blobHash] : changesToApply) {
+            if (conflictPaths.count(filepath)) continue;
+            const SnapshotEntry* ours = oursSnapshot.find(filepath);
+            std::string oldHash = ours ? ours->id.toString() : "";
+            result.changes.push_back({blobHash.empty() ? 'D' : (ours ? 'M' : 'A'), filepath, oldHash, blobHash});
+        }
+        if (!result.failed) {
+            result.tree = Tree::applyChanges(objectsDir, oursTree, changesToApply);
+        }
+        return result;
+    }
+
+    // Merge one file (run on a pool thread). Both sides having the file get a line merge
+    // against the base (empty if both added it), so edits to different regions both
+    // survive; a file deleted on one side is a whole-file conflict. Identical merged blobs
+    // of different files are written once.
+    void mergeFile(FileMerge& file, const std::string& oursLabel, const std::string& theirsLabel, MergeFavor favor,
+                   std::mutex& objectsMutex, std::unordered_set<std::string>& writtenObjects) {
+        auto isBinary = [this](const ObjectId& id) {
+            return !id.isNull() && BinaryDetector::global().isBinaryBlob(objectsDir, id.toString());
+        };
+        file.binary = isBinary(file.ours) || isBinary(file.theirs) || isBinary(file.base);
+        if (file.binary) {
+            // Existing blobs are taken whole; nothing is read or written
+            bool oneSide = file.ours.isNull() || file.theirs.isNull();
+            bool takeTheirs = file.ours.isNull() || (!oneSide && favor == MergeFavor::Theirs);
+            file.conflict = oneSide || favor == MergeFavor::None;
+            file.mergedHash = takeTheirs ? file.theirs.toString() : file.ours.toString();
+            return;
+        }
+
+        auto readBlob = [this](const ObjectId& id) {
+            return id.isNull() ? std::string() : Utils::readFile(Utils::objectPath(objectsDir, id.toString()));
+        };
+        std::string oursContent = readBlob(file.ours);
+        std::string theirsContent = readBlob(file.theirs);
+
+        std::string mergedContent;
+        if (file.ours.isNull() || file.theirs.isNull()) {
+            file.conflict = true;
+            mergedContent = "<<<<<<< " + oursLabel + "\n" +
+                            oursContent + "\n" +
+                            "=======\n" +
+                            theirsContent + "\n" +
+                            ">>>>>>> " + theirsLabel + "\n";
+        } else {
+            LineMergeResult merged = LineMerge::merge(readBlob(file.base), oursContent, theirsContent, oursLabel, theirsLabel, favor);
+            file.conflict = merged.conflicts > 0; // Only the overlapping regions are marked
+            mergedContent = std::move(merged.text);
+        }
+        file.mergedHash = Utils::computeHash(mergedContent);
+        {
+            std::lock_guard<std::mutex> lock(objectsMutex);
+            if (!writtenObjects.insert(file.mergedHash).second) {
+                return; // Another file merged to the same content
+            }
+        }
+        if (!std::filesystem::exists(Utils::objectPath(objectsDir, file.mergedHash)) &&
+            !Utils::writeObject(objectsDir, file.mergedHash, mergedContent)) {
+            file.failed = true;
+        }
+    }
+
+    static std::string hashOrEmpty(const ObjectId& id) { return id.isNull() ? "" : id.toString(); }
+
+    // Carry a rename made on one side over to the other side's snapshot (and the base's),
+    // so the file is merged at its new path. Nothing is moved when the other side deleted
+    // the old path or has a file of its own at the new path.
+    static bool followRename(const RenamePair& rename, Snapshot& baseSnapshot, Snapshot& otherSideSnapshot) {
+        const SnapshotEntry* base = baseSnapshot.find(rename.oldPath);
+        const SnapshotEntry* otherSide = otherSideSnapshot.find(rename.oldPath);
+        if (!base || !otherSide || baseSnapshot.contains(rename.newPath) || otherSideSnapshot.contains(rename.newPath)) {
+            return false;
+        }
+        ObjectId baseId = base->id, otherSideId = otherSide->id;
+        baseSnapshot.remove(rename.oldPath);
+        baseSnapshot.set(rename.newPath, baseId);
+        otherSideSnapshot.remove(rename.oldPath);
+        otherSideSnapshot.set(rename.newPath, otherSideId);
+        return true;
+    }
+
+    // Apply a sorted list of tree changes to a sorted snapshot in one linear pass
+    static Snapshot applyTreeChanges(const Snapshot& base, const std::vector<TreeChange>& changes) {
+        Snapshot result;
+        result.reserve(base.size() + changes.size());
+        auto it = base.begin();
+        size_t k = 0;
+        while (it != base.end() || k < changes.size()) {
+            if (k == changes.size() || (it != base.end() && it->path < changes[k].path)) {
+                result.append(it->path, it->id); // Unchanged entry
+                ++it;
+                continue;
+            }
+            const TreeChange& change = changes[k++];
+            if (it != base.end() && it->path == change.path) {
+                ++it; // Replaced or deleted by the change
+            }
+            if (!change.newHash.empty()) {
+                result.append(change.path, ObjectId(change.newHash));
+            }
+        }
+        return result;
+    }
+};
+
+#endif // TREEMERGE_H
@@ -0,0 +1,268 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "SNAPSHOT_H.h"
+#include <filesystem>
+#include <sstream>
+#include <algorithm>
+#include "Utils.h"
+
+// A single entry of a tree object: either a file (blob) or a subdirectory (tree).
+struct TreeEntry {
+    std::string name;  // Name of the entry within its directory (no slashes)
+    bool isTree;       // True if the entry points to another tree object
+    std::string hash;  // Hash of the blob or tree object
+};
+
+// This class represents a tree object, which stores one directory level of a snapshot.
+// Trees are content-addressed like blobs, so an unchanged directory has the same hash
+// in every commit and its object is written only once.
+class Tree {
+private:
+    std::vector<TreeEntry> entries; // Kept sorted by compareNames()
+    std::string hash;
+
+    // Binary search for an entry with the given name and type
+    std::vector<TreeEntry>::const_iterator locate(const std::string& name, bool isTree) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), name,
+                                   [isTree](const TreeEntry& e, const std::string& n) {
+                                       return compareNames(e.name, e.isTree, n, isTree) < 0;
+                                   });
+        if (it != entries.end() && it->isTree == isTree && it->name == name) {
+            return it;
+        }
+        return entries.end();
+    }
+
+public:
+    Tree() = default;
+
+    // Getters
+    std::string getHash() const { return hash; }
+    const std::vector<TreeEntry>& getEntries() const { return entries; }
+
+    // Compare two entry names the way their full paths sort: a directory compares as if
+    // its name ended in '/', so walking a tree visits files in sorted full-path order.
+    static int compareNames(const std::string& a, bool aIsTree, const std::string& b, bool bIsTree) {
+        size_t common = std::min(a.size(), b.size());
+        int cmp = a.compare(0, common, b, 0, common);
+        if (cmp != 0) {
+            return cmp;
+        }
+        unsigned char nextA = a.size() > common ? a[common] : (aIsTree ? '/' : 0);
+        unsigned char nextB = b.size() > common ? b[common] : (bIsTree ? '/' : 0);
+        return static_cast<int>(nextA) - static_cast<int>(nextB);
+    }
+
+    // Find an entry by name, whether it is a file or a directory
+    const TreeEntry* find(const std::string& name) const {
+        auto it = locate(name, false);
+        if (it == entries.end()) {
+            it = locate(name, true);
+        }
+        return it == entries.end() ? nullptr : &*it;
+    }
+
+    // Insert or replace an entry, keeping the entries sorted
+    void setEntry(const TreeEntry& entry) {
+        auto other = locate(entry.name, !entry.isTree);
+        if (other != entries.end()) {
+            entries.erase(other); // A file replaced by a directory or vice versa
+        }
+        auto it = std::lower_bound(entries.begin(), entries.end(), entry,
+                                   [](const TreeEntry& a, const TreeEntry& b) {
+                                       return compareNames(a.name, a.isTree, b.name, b.isTree) < 0;
+                                   });
+        if (it != entries.end() && it->name == entry.name) {
+            *it = entry;
+        } else {
+            entries.insert(it, entry);
+        }
+        hash.clear(); // Content changed, hash must be recomputed
+    }
+
+    // Remove a file or directory entry by name (no-op if it does not exist)
+    void removeEntry(const std::string& name, bool isTree) {
+        auto it = locate(name, isTree);
+        if (it != entries.end()) {
+            entries.erase(it);
+            hash.clear();
+        }
+    }
+
+    // Save tree object to object store
+    bool saveToObjectStore(const std::filesystem::path& objectsPath) {
+        // Tree content format (one line per entry, directories sorted as "name/"):
+        // blob <hash> <name>\n
+        // tree <hash> <name>\n
+        std::stringstream ss;
+        for (const auto& entry : entries) {
+            ss << (entry.isTree ? "tree " : "blob ") << entry.hash << " " << entry.name << "\n";
+        }
+        std::string treeContent = ss.str();
+        hash = Utils::computeHash(treeContent);
+
+        // Objects are immutable: if this tree already exists, it is shared as-is
+        if (std::filesystem::exists(Utils::objectPath(objectsPath, hash))) {
+            return true;
+        }
+        return Utils::writeObject(objectsPath, hash, treeContent);
+    }
+
+    // Load tree object from object store
+    static Tree loadFromObjectStore(const std::filesystem::path& objectsPath, const std::string& treeHash) {
+        Tree tree;
+        std::string treeContent = Utils::readFile(Utils::objectPath(objectsPath, treeHash));
+        std::stringstream ss(treeContent);
+        std::string line;
+        while (std::getline(ss, line)) {
+            size_t firstSpace = line.find(' ');
+            if (firstSpace == std::string::npos) continue; // Malformed line
+            size_t secondSpace = line.find(' ', firstSpace + 1);
+            if (secondSpace == std::string::npos) continue;
+
+            TreeEntry entry;
+            entry.isTree = line.compare(0, firstSpace, "tree") == 0;
+            entry.hash = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+            entry.name = line.substr(secondSpace + 1);
+            tree.entries.push_back(entry); // Already sorted on disk
+        }
+        tree.hash = treeHash;
+        return tree;
+    }
+
+    // Build a new root tree from a base tree and a set of changes (filepath -> blob hash,
+    // an empty blob hash means the file is deleted). Only the directories on the path to a
+    // changed file are rewritten; every other subtree keeps its hash and is reused as-is.
+    static std::string applyChanges(const std::filesystem::path& objectsPath,
+                                    const std::string& baseTreeHash,
+                                    const std::map<std::string, std::string>& changes) {
+        std::vector<std::pair<std::string, std::string>> sortedChanges(changes.begin(), changes.end());
+        std::string rootHash = applyRange(objectsPath, baseTreeHash, sortedChanges, 0, sortedChanges.size(), 0);
+        if (rootHash.empty()) {
+            // Everything was deleted: a commit still needs a (empty) root tree
+            Tree emptyTree;
+            emptyTree.saveToObjectStore(objectsPath);
+            rootHash = emptyTree.getHash();
+        }
+        return rootHash;
+    }
+
+    // Resolve a path ("dir/sub/file" or "dir/sub") below a root tree to the hash of the
+    // blob or tree it names. Only the trees along the path are loaded.
+    // Returns "" if the path does not exist.
+    static std::string lookupPath(const std::filesystem::path& objectsPath,
+                                  const std::string& rootTreeHash,
+                                  const std::string& path) {
+        bool isTree;
+        return lookupPath(objectsPath, rootTreeHash, path, isTree);
+    }
+
+    // Same, also telling whether the path names a tree (a directory) or a blob
+    static std::string lookupPath(const std::filesystem::path& objectsPath,
+                                  const std::string& rootTreeHash,
+                                  const std::string& path,
+                                  bool& isTree) {
+        std::string hash = rootTreeHash;
+        isTree = true; // The root itself
+        size_t start = 0;
+        while (!hash.empty() && start < path.size()) {
+            size_t slashPos = path.find('/', start);
+            std::string name = path.substr(start, slashPos == std::string::npos ? std::string::npos : slashPos - start);
+            Tree tree = loadFromObjectStore(objectsPath, hash);
+            const TreeEntry* entry = tree.find(name);
+            if (!entry || (slashPos != std::string::npos && !entry->isTree)) {
+                return "";
+            }
+            hash = entry->hash;
+            isTree = entry->isTree;
+            start = slashPos == std::string::npos ? path.size() : slashPos + 1;
+        }
+        return hash;
+    }
+
+    // Recursively expand a tree into a flat snapshot. Entries are appended in sorted
+    // path order (see compareNames), so the snapshot needs no sorting afterwards.
+    // `directory` is the interned path of the tree ("" for the root).
+    static void flatten(const std::filesystem::path& objectsPath,
+                        const std::string& treeHash,
+                        std::string_view directory,
+                        Snapshot& snapshot) {
+        PathPool& pool = PathPool::global();
+        Tree tree = loadFromObjectStore(objectsPath, treeHash);
+        for (const auto& entry : tree.entries) {
+            std::string_view path = pool.join(directory, entry.name);
+            if (entry.isTree) {
+                flatten(objectsPath, entry.hash, path, snapshot);
+            } else {
+                snapshot.append(path, ObjectId(entry.hash));
+            }
+        }
+    }
+
+private:
+    // Apply changes[begin, end) (all sharing the first prefixLen characters of their path)
+    // to the tree baseTreeHash. Returns the new tree hash, or "" if the tree became empty.
+    static std::string applyRange(const std::filesystem::path& objectsPath,
+                                  const std::string& baseTreeHash,
+                                  const std::vector<std::pair<std::string, std::string>>& changes,
+                                  size_t begin, size_t end, size_t prefixLen) {
+        Tree tree;
+        if (!baseTreeHash.empty()) {
+            tree = loadFromObjectStore(objectsPath, baseTreeHash);
+        }
+
+        size_t i = begin;
+        while (i < end) {
+            const std::string& filepath = changes[i].first;
+            size_t slashPos = filepath.find('/', prefixLen);
+
+            if (slashPos == std::string::npos) {
+                // A file directly inside this directory
+                std::string name = filepath.substr(prefixLen);
+                if (changes[i].second.empty()) {
+                    tree.removeEntry(name, false);
+                } else {
+                    tree.setEntry({name, false, changes[i].second});
+                }
+                ++i;
+                continue;
+            }
+
+            // A file inside a subdirectory: all changes under the same subdirectory
+            // are contiguous because the changes are sorted by path
+            std::string dirName = filepath.substr(prefixLen, slashPos - prefixLen);
+            size_t subPrefixLen = slashPos + 1;
+            size_t j = i + 1;
+            while (j < end && changes[j].first.size() > subPrefixLen &&
+                   changes[j].first.compare(0, subPrefixLen, filepath, 0, subPrefixLen) == 0) {
+                ++j;
+            }
+
+            const TreeEntry* existing = tree.find(dirName);
+            std::string subBaseHash = (existing && existing->isTree) ? existing->hash : "";
+            std::string subTreeHash = applyRange(objectsPath, subBaseHash, changes, i, j, subPrefixLen);
+            if (subTreeHash.empty()) {
+                if (existing && existing->isTree) {
+                    tree.removeEntry(dirName, true); // Directory became empty
+                }
+            } else {
+                tree.setEntry({dirName, true, subTreeHash});
+            }
+            i = j;
+        }
+
+        if (tree.entries.empty()) {
+            return "";
+        }
+        if (tree.hash.empty()) { // Only write trees whose content actually changed
+            tree.saveToObjectStore(objectsPath);
+        }
+        return tree.hash;
+    }
+};
+
+#endif // TREE_H
@@ -9,6 +9,9 @@
 #include <chrono>   // For std::chrono
 #include <iomanip>  // For std::put_time
 #include <ctime>    // For std::time, std::localtime
+#include <cstdint>  // For fixed-width integers in binary object formats
+#include <sstream>
+#include <algorithm>
 
 namespace Utils {
     // Function to check if a directory exists
@@ -29,7 +32,7 @@ namespace Utils {
 
     // Function to write content to a file
     bool writeFile(const std::string& filepath, const std::string& content) {
-        std::ofstream outFile(filepath);
+        std::ofstream outFile(filepath, std::ios::binary);
         if (!outFile.is_open()) {
             std::cerr << "Error: Could not open file for writing: " << filepath << std::endl;
             return false;
@@ -41,7 +44,7 @@ namespace Utils {
 
     // Function to read content from a file
     std::string readFile(const std::string& filepath) {
-        std::ifstream inFile(filepath);
+        std::ifstream inFile(filepath, std::ios::binary);
         if (!inFile.is_open()) {
             // std::cerr << "Error: Could not open file for reading: " << filepath << std::endl;
             return ""; // Return empty string or handle error as appropriate
@@ -61,20 +64,161 @@ namespace Utils {
         return std::to_string(hash) + "_temp_hash"; // Append a string to make it visually distinct
     }
 
+    // Function to get the path of an object in the object store. Objects are fanned out
+    // into subdirectories named after the first two characters of their hash, so that
+    // looking up an abbreviated hash only has to read one small directory.
+    std::filesystem::path objectPath(const std::filesystem::path& objectsDir, const std::string& hash) {
+        if (hash.size() <= 2) {
+            return objectsDir / hash; // Not a valid hash; never matches an object
+        }
+        return objectsDir / hash.substr(0, 2) / hash.substr(2);
+    }
+
+    // Function to write an object to the object store, creating its fan-out directory
+    bool writeObject(const std::filesystem::path& objectsDir, const std::string& hash, const std::string& content) {
+        std::filesystem::path path = objectPath(objectsDir, hash);
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        return writeFile(path.string(), content);
+    }
+
+    // Function to find every object whose hash starts with `prefix` (at least two
+    // characters). Only the fan-out directory of the prefix is read. Results are sorted.
+    std::vector<std::string> findObjectsByPrefix(const std::filesystem::path& objectsDir, const std::string& prefix) {
+        std::vector<std::string> matches;
+        if (prefix.size() < 2 || prefix.find_first_of("/\\.") != std::string::npos) {
+            return matches;
+        }
+        std::filesystem::path bucket = objectsDir / prefix.substr(0, 2);
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(bucket, ec)) {
+            std::string rest = entry.path().filename().string();
+            if (rest.compare(0, prefix.size() - 2, prefix, 2, std::string::npos) == 0) {
+                matches.push_back(prefix.substr(0, 2) + rest);
+            }
+        }
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
     // Function to get the base name (filename only) from a path
     std::string getBaseName(const std::string& filepath) {
         return std::filesystem::path(filepath).filename().string();
     }
     
-    // Function to get current timestamp in a readable format
-    std::string getCurrentTimestamp() {
+    // Function to get the current time as seconds since the Unix epoch
+    int64_t getCurrentEpoch() {
         auto now = std::chrono::system_clock::now();
-        std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
+        return static_cast<int64_t>(std::chrono::system_clock::to_time_t(now));
+    }
+
+    // Function to get the local timezone's offset from UTC (minutes east) at a given time
+    int getLocalTimezoneOffset(int64_t epochSeconds) {
+        std::time_t time = static_cast<std::time_t>(epochSeconds);
+        std::tm local = *std::localtime(&time);
+        std::tm utc = *std::gmtime(&time);
+        utc.tm_isdst = local.tm_isdst; // Let mktime read the UTC fields as local wall-clock time
+        return static_cast<int>(std::difftime(time, std::mktime(&utc)) / 60);
+    }
+
+    // Function to format seconds since the Unix epoch in a readable format, as wall-clock
+    // time in the given timezone followed by its offset (e.g. "2024-05-01 14:03:00 +0200")
+    std::string formatTimestamp(int64_t epochSeconds, int tzOffsetMinutes) {
+        std::time_t time = static_cast<std::time_t>(epochSeconds + tzOffsetMinutes * 60);
+        int offset = tzOffsetMinutes < 0 ? -tzOffsetMinutes : tzOffsetMinutes;
         std::stringstream ss;
-        ss << std::put_time(std::localtime(&currentTime), "%Y-%m-%d %H:%M:%S");
+        ss << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M:%S") << ' '
+           << (tzOffsetMinutes < 0 ? '-' : '+')
+           << std::setfill('0') << std::setw(2) << offset / 60 << std::setw(2) << offset % 60;
         return ss.str();
     }
 
+    // Function to get current timestamp in a readable format
+    std::string getCurrentTimestamp() {
+        int64_t now = getCurrentEpoch();
+        return formatTimestamp(now, getLocalTimezoneOffset(now));
+    }
+
+    // Function to parse a date given on the command line into seconds since the Unix epoch.
+    // Accepts "@<seconds>", "YYYY-MM-DD", "YYYY-MM-DD HH:MM[:SS]" (local time) and
+    // "<n> <seconds|minutes|hours|days|weeks> ago". Returns false if the text is not a date.
+    bool parseDate(const std::string& text, int64_t& epochSeconds) {
+        if (text.size() > 1 && text[0] == '@') {
+            try {
+                size_t used = 0;
+                epochSeconds = std::stoll(text.substr(1), &used);
+                return used == text.size() - 1;
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+
+        std::tm date = {};
+        std::istringstream iss(text);
+        iss >> std::get_time(&date, "%Y-%m-%d");
+        if (!iss.fail()) {
+            std::string rest;
+            std::getline(iss, rest);
+            if (rest.find_first_not_of(' ') != std::string::npos) {
+                std::istringstream timeStream(rest);
+                char separator = 0;
+                timeStream >> date.tm_hour >> separator >> date.tm_min;
+                if (timeStream.fail() || separator != ':') {
+                    return false;
+                }
+                if (timeStream >> separator) { // Optional seconds
+                    if (separator != ':' || !(timeStream >> date.tm_sec)) {
+                        return false;
+                    }
+                }
+                timeStream.clear();
+                std::string extra;
+                if (timeStream >> extra) {
+                    return false; // Trailing garbage
+                }
+            }
+            date.tm_isdst = -1;
+            epochSeconds = static_cast<int64_t>(std::mktime(&date));
+            return true;
+        }
+
+        // Relative dates: "<n> <unit> ago"
+        std::istringstream relative(text);
+        int64_t count;
+        std::string unit, ago;
+        if (!(relative >> count >> unit >> ago) || ago != "ago" || count < 0) {
+            return false;
+        }
+        if (unit.size() > 1 && unit.back() == 's') {
+            unit.pop_back();
+        }
+        int64_t seconds;
+        if (unit == "second") seconds = 1;
+        else if (unit == "minute") seconds = 60;
+        else if (unit == "hour") seconds = 3600;
+        else if (unit == "day") seconds = 86400;
+        else if (unit == "week") seconds = 7 * 86400;
+        else return false;
+        epochSeconds = getCurrentEpoch() - count * seconds;
+        return true;
+    }
+
+    // Function to append an unsigned integer to a binary buffer (little-endian, `bytes` wide)
+    void appendLittleEndian(std::string& buffer, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) {
+            buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // Function to read an unsigned little-endian integer of `bytes` bytes
+    uint64_t readLittleEndian(const char* data, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
     // Function to check if a string starts with a given prefix
     bool startsWith(const std::string& s, const std::string& prefix) {
         return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
@@ -0,0 +1,51 @@
+#ifndef WORKTREE_H
+#define WORKTREE_H
+
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include "Utils.h"
+#include "SNAPSHOT_H.h"
+#include "PATHPOOL_H.h"
+
+// This class scans the working directory into a snapshot of file hashes.
+class WorkingTree {
+public:
+    // Hash every file in the working directory, skipping the .minigit and .git directories
+    // at the top level. The result is sorted by path.
+    static Snapshot scan(const std::filesystem::path& workingDir) {
+        Snapshot snapshot;
+        scanDirectory(workingDir, "", snapshot);
+        snapshot.sortByPath(); // Directory iteration order is unspecified
+        return snapshot;
+    }
+
+    // Files that are never reported as untracked (they are still compared when tracked)
+    static bool ignoredWhenUntracked(std::string_view path) {
+        return path == ".gitignore";
+    }
+
+private:
+    // Relative paths are built from the interned directory handle and the entry name,
+    // so each directory prefix is formatted once instead of once per file.
+    static void scanDirectory(const std::filesystem::path& absoluteDir,
+                              std::string_view relativeDir,
+                              Snapshot& snapshot) {
+        PathPool& pool = PathPool::global();
+        for (const auto& entry : std::filesystem::directory_iterator(absoluteDir)) {
+            std::string name = entry.path().filename().string();
+            bool directory = entry.is_directory() && !entry.is_symlink();
+            if (relativeDir.empty() && directory && (name == ".minigit" || name == ".git")) {
+                continue; // Repository metadata, not part of the working tree
+            }
+            if (directory) {
+                scanDirectory(entry.path(), pool.join(relativeDir, name), snapshot);
+            } else if (entry.is_regular_file()) {
+                std::string fileContent = Utils::readFile(entry.path().string());
+                snapshot.append(pool.join(relativeDir, name), ObjectId(Utils::computeHash(fileContent)));
+            }
+        }
+    }
+};
+
+#endif // WORKTREE_H
@@ -5,6 +5,8 @@
 #include <functional> // For std::function
 #include <numeric>    // For std::accumulate
 #include <filesystem> // Required for std::filesystem::current_path()
+#include <sstream>    // For reading merge-tree pairs
+#include <cstring>    // For std::strlen
 
 // IMPORTANT CHANGE: Renamed from .cpp to .h
 #include "REPOSITORY_H.h" // Include your main repository header
@@ -16,19 +18,39 @@ void printGeneralUsage() {
     std::cout << "Available commands:\n";
     std::cout << "  init                         Initialize a new MiniGit repository.\n";
     std::cout << "  add <filename>...            Add file(s) to the staging area.\n";
+    std::cout << "  rm [--cached] <filename>...  Remove file(s) from the working directory and the index.\n";
     std::cout << "  commit -m \"<message>\"        Record changes to the repository.\n";
-    std::cout << "  log                          Show commit history.\n";
+    std::cout << "  log [options] [<rev>...]     Show commit history (-n <count>, --all, --topo-order,\n";
+    std::cout << "                               --first-parent, --oneline, --graph, --since <date>,\n";
+    std::cout << "                               --until <date>, -- <path>). Revisions may be ranges\n";
+    std::cout << "                               such as A..B, A...B or ^A, or ancestors like HEAD~2.\n";
     std::cout << "  branch <branch-name>         Create a new branch.\n";
     std::cout << "  checkout <ref>               Switch branches or restore working tree files.\n";
     std::cout << "  status                       Show the working tree status.\n";
-    std::cout << "  ls-branches                  List existing branches.\n";
-    std::cout << "  merge <branch-name>          Join two or more development histories together.\n";
+    std::cout << "  ls-branches [-v]             List existing branches (-v: ahead/behind HEAD).\n";
+    std::cout << "  merge <branch-name>...       Join two or more development histories together\n";
+    std::cout << "                               (several branches make one octopus merge commit;\n";
+    std::cout << "                               -X ours / -X theirs settles conflicting changes).\n";
+    std::cout << "  diff [options] [<a> <b>]     Show changes between the working directory and the index,\n";
+    std::cout << "                               the index and HEAD (--cached), or two commits (also\n";
+    std::cout << "                               <a>..<b> and <a>...<b>). Options: --name-status,\n";
+    std::cout << "                               --patience, --histogram, -U<n>, -M<n> (rename\n";
+    std::cout << "                               similarity), -C (copies), --no-renames.\n";
+    std::cout << "  merge-base [--all] <a> <b>   Find the best common ancestor(s) of two commits.\n";
+    std::cout << "  merge-tree <a> <b>           Merge two commits in the object store only: print the\n";
+    std::cout << "                               merged tree and the conflicted files (--name-only,\n";
+    std::cout << "                               --no-messages; --stdin reads one pair per line).\n";
+    std::cout << "  commit-graph write           Write the commit-graph file to speed up history queries.\n";
+    std::cout << "  rev-list [--count] <rev>...  List (or count) the commits selected by revisions;\n";
+    std::cout << "                               --left-right --count <a>...<b> counts each side.\n";
     // Add other commands as you implement them
 }
 
 void printCommandUsage(const std::string& command) {
     if (command == "add") {
         std::cerr << "Usage: minigit add <filename>...\n";
+    } else if (command == "rm") {
+        std::cerr << "Usage: minigit rm [--cached] <filename>...\n";
     } else if (command == "commit") {
         std::cerr << "Usage: minigit commit -m \"<message>\"\n";
     } else if (command == "branch") {
@@ -36,8 +58,28 @@ void printCommandUsage(const std::string& command) {
     } else if (command == "checkout") {
         std::cerr << "Usage: minigit checkout <branch-name> | <commit-hash>\n";
     } else if (command == "merge") {
-        std::cerr << "Usage: minigit merge <branch-name>\n";
-    } else if (command == "log" || command == "status" || command == "ls-branches") {
+        std::cerr << "Usage: minigit merge [-X ours | -X theirs] <branch-name>...\n";
+    } else if (command == "diff") {
+        std::cerr << "Usage: minigit diff [--cached] [--name-status] [--patience | --histogram] [-U<n>]\n"
+                  << "                    [-M<n> | --no-renames] [-C]\n"
+                  << "       minigit diff [options] <commit> <commit>\n"
+                  << "       minigit diff [options] <commit>..<commit> | <commit>...<commit>\n";
+    } else if (command == "merge-base") {
+        std::cerr << "Usage: minigit merge-base [--all] <commit> <commit>\n";
+    } else if (command == "merge-tree") {
+        std::cerr << "Usage: minigit merge-tree [--name-only] [--no-messages] [-X ours | -X theirs] <commit> <commit>\n"
+                  << "       minigit merge-tree [--name-only] [-X ours | -X theirs] --stdin\n";
+    } else if (command == "commit-graph") {
+        std::cerr << "Usage: minigit commit-graph write\n";
+    } else if (command == "rev-list") {
+        std::cerr << "Usage: minigit rev-list [--count] <rev>...\n"
+                  << "       minigit rev-list --left-right --count <commit>...<commit>\n";
+    } else if (command == "ls-branches") {
+        std::cerr << "Usage: minigit ls-branches [-v]\n";
+    } else if (command == "log") {
+        std::cerr << "Usage: minigit log [-n <count>] [--all] [--topo-order] [--first-parent] [--oneline] [--graph]\n"
+                  << "                  [--since <date>] [--until <date>] [<rev>...] [-- <path>]\n";
+    } else if (command == "status") {
         // These commands don't take additional arguments
         std::cerr << "Usage: minigit " << command << "\n";
     } else {
@@ -46,6 +88,29 @@ void printCommandUsage(const std::string& command) {
     }
 }
 
+// Read the option of -X <option>, -X<option> or --strategy-option=<option> at argv[i]
+// (advancing i past a separate value). Returns false if argv[i] is not such an option;
+// an option other than "ours" or "theirs" sets valid to false.
+bool parseMergeFavor(int argc, char* argv[], int& i, MergeFavor& favor, bool& valid) {
+    std::string arg = argv[i];
+    std::string value;
+    if (arg == "-X") {
+        value = i + 1 < argc ? argv[++i] : "";
+    } else if (Utils::startsWith(arg, "-X")) {
+        value = arg.substr(2);
+    } else if (Utils::startsWith(arg, "--strategy-option=")) {
+        value = arg.substr(std::strlen("--strategy-option="));
+    } else {
+        return false;
+    }
+    valid = value == "ours" || value == "theirs";
+    favor = value == "ours" ? MergeFavor::Ours : value == "theirs" ? MergeFavor::Theirs : MergeFavor::None;
+    if (!valid) {
+        std::cerr << "Error: Unknown strategy option '" << value << "' (use ours or theirs).\n";
+    }
+    return true;
+}
+
 // --- Main function for CLI parsing and execution ---
 
 int main(int argc, char* argv[]) {
@@ -75,6 +140,17 @@ int main(int argc, char* argv[]) {
         for (int i = 2; i < argc; ++i) {
             repo.add(argv[i]);
         }
+    } else if (command == "rm") {
+        // 'rm' requires at least one filename, optionally preceded by '--cached'
+        bool cached = argc > 2 && std::string(argv[2]) == "--cached";
+        int first = cached ? 3 : 2;
+        if (argc <= first) {
+            printCommandUsage(command);
+            return 1;
+        }
+        for (int i = first; i < argc; ++i) {
+            repo.remove(argv[i], cached);
+        }
     } else if (command == "commit") {
         // 'commit' requires '-m' and a message
         if (argc < 4 || std::string(argv[2]) != "-m") {
@@ -84,13 +160,61 @@ int main(int argc, char* argv[]) {
         std::string message = argv[3]; // The commit message
         repo.commit(message);
     } else if (command == "log") {
-        // 'log' takes no additional arguments
-        if (argc > 2) {
-            std::cerr << "Error: 'log' command does not take arguments.\n";
-            printCommandUsage(command);
-            return 1;
+        LogOptions options;
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--all") {
+                options.all = true;
+            } else if (option == "--topo-order") {
+                options.topoOrder = true;
+            } else if (option == "--first-parent") {
+                options.firstParent = true;
+            } else if (option == "--oneline") {
+                options.oneline = true;
+            } else if (option == "--graph") {
+                options.drawGraph = true;
+            } else if (option == "--since" || option == "--until" ||
+                       Utils::startsWith(option, "--since=") || Utils::startsWith(option, "--until=")) {
+                // Accept both '--since <date>' and '--since=<date>'
+                size_t equalsPos = option.find('=');
+                std::string date = equalsPos != std::string::npos ? option.substr(equalsPos + 1)
+                                                                  : (i + 1 < argc ? argv[++i] : "");
+                int64_t epochSeconds;
+                if (!Utils::parseDate(date, epochSeconds)) {
+                    std::cerr << "Error: Invalid date '" << date << "'.\n";
+                    printCommandUsage(command);
+                    return 1;
+                }
+                (Utils::startsWith(option, "--since") ? options.since : options.until) = epochSeconds;
+            } else if (option == "--" && i + 2 == argc) {
+                // Limit to commits that changed one file or directory
+                std::string path = std::filesystem::path(argv[++i]).lexically_normal().generic_string();
+                while (!path.empty() && path.back() == '/') {
+                    path.pop_back();
+                }
+                if (path.empty() || path == "." || Utils::startsWith(path, "../")) {
+                    std::cerr << "Error: '" << argv[i] << "' is not a path inside the repository.\n";
+                    return 1;
+                }
+                options.path = path;
+            } else if (Utils::startsWith(option, "-n")) {
+                // Accept both '-n 5' and '-n5'
+                std::string count = option.size() > 2 ? option.substr(2) : (i + 1 < argc ? argv[++i] : "");
+                if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+                    std::cerr << "Error: '-n' requires a non-negative number.\n";
+                    printCommandUsage(command);
+                    return 1;
+                }
+                options.maxCount = std::stoul(count);
+            } else if (option.empty() || option[0] != '-') {
+                options.revisions.push_back(option); // A revision or range, e.g. "master..HEAD"
+            } else {
+                std::cerr << "Error: Unknown option '" << option << "' for 'log'.\n";
+                printCommandUsage(command);
+                return 1;
+            }
         }
-        repo.log();
+        repo.log(options);
     } else if (command == "branch") {
         // 'branch' requires a branch name
         if (argc < 3) {
@@ -116,21 +240,187 @@ int main(int argc, char* argv[]) {
         }
         repo.status();
     } else if (command == "ls-branches") {
-        // 'ls-branches' takes no additional arguments
-        if (argc > 2) {
-            std::cerr << "Error: 'ls-branches' command does not take arguments.\n";
+        // 'ls-branches' takes only '-v'
+        bool verbose = argc == 3 && (std::string(argv[2]) == "-v" || std::string(argv[2]) == "--verbose");
+        if (argc > 2 && !verbose) {
             printCommandUsage(command);
             return 1;
         }
-        repo.listBranches();
+        repo.listBranches(verbose);
     } else if (command == "merge") {
         // 'merge' requires a branch name to merge from
-        if (argc < 3) {
+        MergeFavor favor = MergeFavor::None;
+        std::vector<std::string> branches;
+        for (int i = 2; i < argc; ++i) {
+            bool valid = true;
+            if (parseMergeFavor(argc, argv, i, favor, valid)) {
+                if (!valid) {
+                    printCommandUsage(command);
+                    return 1;
+                }
+            } else {
+                branches.push_back(argv[i]);
+            }
+        }
+        if (branches.empty()) {
+            printCommandUsage(command);
+            return 1;
+        }
+        // Several branches make one octopus merge commit; a failed or conflicted merge
+        // exits non-zero
+        bool merged = branches.size() == 1 ? repo.merge(branches.front(), favor)
+                                           : repo.mergeOctopus(branches, favor);
+        if (!merged) {
+            return 1;
+        }
+    } else if (command == "diff") {
+        DiffOptions options;
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--cached" || option == "--staged") {
+                options.cached = true;
+            } else if (option == "--name-status") {
+                options.nameStatus = true;
+            } else if (option == "--patience" || option == "--diff-algorithm=patience") {
+                options.algorithm = DiffAlgorithm::Patience;
+            } else if (option == "--histogram" || option == "--diff-algorithm=histogram") {
+                options.algorithm = DiffAlgorithm::Histogram;
+            } else if (option == "--diff-algorithm=myers" || option == "--diff-algorithm=default") {
+                options.algorithm = DiffAlgorithm::Myers;
+            } else if (Utils::startsWith(option, "-U") || Utils::startsWith(option, "--unified=")) {
+                // Accept both '-U5' and '--unified=5'
+                std::string count = option.substr(option[1] == 'U' ? 2 : strlen("--unified="));
+                if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+                    std::cerr << "Error: '" << option << "' requires a non-negative number.\n";
+                    printCommandUsage(command);
+                    return 1;
+                }
+                options.context = std::stoul(count);
+            } else if (option == "--no-renames") {
+                options.findRenames = false;
+            } else if (option == "-C" || option == "--find-copies") {
+                options.findCopies = true;
+            } else if (Utils::startsWith(option, "-M") || option == "--find-renames" ||
+                       Utils::startsWith(option, "--find-renames=")) {
+                // Accept '-M', '-M60', '--find-renames' and '--find-renames=60'
+                std::string percent = option[1] == 'M' ? option.substr(2)
+                                                       : option.substr(std::min(option.size(), strlen("--find-renames=")));
+                if (percent.size() > 3 || percent.find_first_not_of("0123456789") != std::string::npos ||
+                    (!percent.empty() && std::stoi(percent) > 100)) {
+                    std::cerr << "Error: '" << option << "' takes a similarity between 0 and 100.\n";
+                    printCommandUsage(command);
+                    return 1;
+                }
+                options.findRenames = true;
+                if (!percent.empty()) {
+                    options.renameThreshold = std::stoi(percent);
+                }
+            } else if (option.empty() || option[0] != '-') {
+                options.revisions.push_back(option);
+            } else {
+                std::cerr << "Error: Unknown option '" << option << "' for 'diff'.\n";
+                printCommandUsage(command);
+                return 1;
+            }
+        }
+        if (options.cached && !options.revisions.empty()) {
+            std::cerr << "Error: '--cached' compares the index with HEAD and takes no commits.\n";
+            printCommandUsage(command);
+            return 1;
+        }
+        if (!repo.diff(options)) {
+            return 1;
+        }
+    } else if (command == "merge-base") {
+        // 'merge-base' takes two commits, optionally preceded by '--all'
+        bool showAll = argc == 5 && std::string(argv[2]) == "--all";
+        if (argc != 4 && !showAll) {
+            printCommandUsage(command);
+            return 1;
+        }
+        if (!repo.mergeBase(argv[argc - 2], argv[argc - 1], showAll)) {
+            return 1;
+        }
+    } else if (command == "merge-tree") {
+        bool nameOnly = false, messages = true, fromStdin = false;
+        MergeFavor favor = MergeFavor::None;
+        std::vector<std::string> commits;
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            bool valid = true;
+            if (parseMergeFavor(argc, argv, i, favor, valid)) {
+                if (!valid) {
+                    printCommandUsage(command);
+                    return 1;
+                }
+            } else if (option == "--name-only") {
+                nameOnly = true;
+            } else if (option == "--no-messages") {
+                messages = false;
+            } else if (option == "--stdin") {
+                fromStdin = true;
+            } else if (option.empty() || option[0] != '-') {
+                commits.push_back(option);
+            } else {
+                std::cerr << "Error: Unknown option '" << option << "' for 'merge-tree'.\n";
+                printCommandUsage(command);
+                return 1;
+            }
+        }
+        if (fromStdin != commits.empty() || (!fromStdin && commits.size() != 2)) {
             printCommandUsage(command);
             return 1;
         }
-        std::string branchToMerge = argv[2];
-        repo.merge(branchToMerge);
+        if (!fromStdin) {
+            bool clean = false;
+            if (!repo.mergeTree(commits[0], commits[1], nameOnly, messages, clean, favor)) {
+                return 128;
+            }
+            return clean ? 0 : 1;
+        }
+        // One "<commit> <commit>" pair per line; each result ends with a blank line, and the
+        // merges share one cache of tree merges
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            std::istringstream pair(line);
+            std::string ours, theirs;
+            if (!(pair >> ours >> theirs)) {
+                continue;
+            }
+            bool clean = false;
+            if (!repo.mergeTree(ours, theirs, nameOnly, false, clean, favor)) {
+                return 128;
+            }
+            std::cout << std::endl;
+        }
+    } else if (command == "commit-graph") {
+        // 'commit-graph' currently supports 'write'
+        if (argc != 3 || std::string(argv[2]) != "write") {
+            printCommandUsage(command);
+            return 1;
+        }
+        if (!repo.writeCommitGraph()) {
+            return 1;
+        }
+    } else if (command == "rev-list") {
+        // 'rev-list' takes at least one revision, optionally preceded by '--count' and
+        // '--left-right'
+        bool countOnly = false, leftRight = false;
+        int first = 2;
+        for (; first < argc; ++first) {
+            std::string option = argv[first];
+            if (option == "--count") countOnly = true;
+            else if (option == "--left-right") leftRight = true;
+            else break;
+        }
+        std::vector<std::string> revisions(argv + first, argv + argc);
+        if (revisions.empty()) {
+            printCommandUsage(command);
+            return 1;
+        }
+        if (!repo.revList(revisions, countOnly, leftRight)) {
+            return 1;
+        }
     } else {
         // Handle unknown commands
         printCommandUsage(command);
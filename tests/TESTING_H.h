@@ -0,0 +1,45 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <iostream>
+#include <string>
+
+// Minimal checks for the test programs in this directory. Each program is a single
+// translation unit that includes the headers it tests; build and run one from the
+// repository root with e.g.
+//     g++ -std=c++17 -pthread -I. tests/test_loggraph.cpp -o test_loggraph && ./test_loggraph
+// A program prints every failed check and exits non-zero if there was one.
+
+inline int testFailures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++testFailures;                                                           \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                    \
+    do {                                                                              \
+        const auto& actualValue = (actual);                                           \
+        const auto& expectedValue = (expected);                                       \
+        if (!(actualValue == expectedValue)) {                                        \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #actual ", " #expected ") failed\n" \
+                      << "  actual:   " << actualValue << "\n"                      \
+                      << "  expected: " << expectedValue << "\n";                   \
+            ++testFailures;                                                           \
+        }                                                                             \
+    } while (0)
+
+// Report the outcome; the return value is the program's exit status
+inline int testResult(const std::string& name) {
+    if (testFailures == 0) {
+        std::cout << name << ": all checks passed" << std::endl;
+        return 0;
+    }
+    std::cerr << name << ": " << testFailures << " check(s) failed" << std::endl;
+    return 1;
+}
+
+#endif // TESTING_H
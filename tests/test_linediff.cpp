@@ -0,0 +1,136 @@
+// Tests for LineDiff: the Myers, patience and histogram line diffs and unified output
+
+#include <random>
+#include <sstream>
+#include "TESTING_H.h"
+#include "LINEDIFF_H.h"
+
+static const DiffAlgorithm kAlgorithms[] = {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram};
+
+static std::string unified(const std::string& oldText, const std::string& newText, size_t context) {
+    std::ostringstream stream;
+    {
+        OutputBuffer out(stream);
+        LineDiff(oldText, newText).writeUnified(out, context);
+    }
+    return stream.str();
+}
+
+// Length of the longest common subsequence of two line lists
+static size_t lcsLength(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b) {
+    std::vector<size_t> row(b.size() + 1, 0), previous(b.size() + 1, 0);
+    for (size_t i = 1; i <= a.size(); ++i) {
+        std::swap(row, previous);
+        for (size_t j = 1; j <= b.size(); ++j) {
+            row[j] = a[i - 1] == b[j - 1] ? previous[j - 1] + 1 : std::max(previous[j], row[j - 1]);
+        }
+    }
+    return row[b.size()];
+}
+
+// The regions must be ordered, and replaying them on the old lines must give the new
+// lines, with every line outside a region equal on both sides. Returns the number of
+// changed lines (removed plus added).
+static size_t checkRegions(const std::string& oldText, const std::string& newText, DiffAlgorithm algorithm) {
+    LineDiff diff(oldText, newText, algorithm);
+    const auto& oldLines = diff.oldLines();
+    const auto& newLines = diff.newLines();
+    std::string rebuilt;
+    size_t oldLine = 0, newLine = 0, changed = 0;
+    bool ordered = true;
+    for (const DiffRegion& region : diff.regions()) {
+        ordered = ordered && region.oldStart >= oldLine && region.newStart >= newLine &&
+                  region.oldStart - oldLine == region.newStart - newLine && region.oldCount + region.newCount > 0;
+        for (; oldLine < region.oldStart && newLine < newLines.size(); ++oldLine, ++newLine) {
+            ordered = ordered && oldLines[oldLine] == newLines[newLine];
+            rebuilt.append(oldLines[oldLine]);
+        }
+        for (size_t k = 0; k < region.newCount && region.newStart + k < newLines.size(); ++k) {
+            rebuilt.append(newLines[region.newStart + k]);
+        }
+        oldLine = region.oldStart + region.oldCount;
+        newLine = region.newStart + region.newCount;
+        changed += region.oldCount + region.newCount;
+    }
+    for (; oldLine < oldLines.size() && newLine < newLines.size(); ++oldLine, ++newLine) {
+        ordered = ordered && oldLines[oldLine] == newLines[newLine];
+        rebuilt.append(oldLines[oldLine]);
+    }
+    CHECK(ordered);
+    CHECK(oldLine == oldLines.size() && newLine == newLines.size());
+    CHECK_EQ(rebuilt, newText);
+    return changed;
+}
+
+static void testUnifiedOutput() {
+    CHECK_EQ(unified("a\nb\nc\n", "a\nb\nc\n", 3), "");
+    CHECK_EQ(unified("a\nb\nc\n", "a\nB\nc\n", 3), "@@ -1,3 +1,3 @@\n a\n-b\n+B\n c\n");
+    CHECK_EQ(unified("a\nb\nc\nd\ne\n", "a\nb\nc\nd\ne\nf\n", 1), "@@ -5 +5,2 @@\n e\n+f\n");
+    CHECK_EQ(unified("", "x\n", 3), "@@ -0,0 +1 @@\n+x\n");
+    CHECK_EQ(unified("x", "y", 3), "@@ -1 +1 @@\n-x\n\\ No newline at end of file\n+y\n\\ No newline at end of file\n");
+}
+
+// Edits far apart in a long file end up in separate hunks
+static void testSeparateHunks() {
+    std::string oldText, newText;
+    for (int i = 0; i < 40; ++i) {
+        oldText += "line " + std::to_string(i) + "\n";
+        newText += (i == 5 || i == 30 ? "changed " : "line ") + std::to_string(i) + "\n";
+    }
+    std::string output = unified(oldText, newText, 3);
+    CHECK_EQ(std::count(output.begin(), output.end(), '@'), 8); // Two "@@ ... @@" headers
+    CHECK(output.find("@@ -3,7 +3,7 @@") == 0);
+    CHECK(output.find("@@ -28,7 +28,7 @@") != std::string::npos);
+}
+
+// Random texts over a small alphabet (so lines repeat a lot): every algorithm must give
+// a valid diff, and Myers a minimal one
+static void testRandomTexts() {
+    std::mt19937 random(67);
+    const char* alphabet[] = {"a\n", "b\n", "c\n", "d\n", "e\n"};
+    auto randomText = [&](size_t maxLines) {
+        std::string text;
+        size_t lines = random() % (maxLines + 1);
+        for (size_t i = 0; i < lines; ++i) {
+            text += alphabet[random() % 5];
+        }
+        if (!text.empty() && random() % 8 == 0) {
+            text.pop_back(); // Last line without a newline
+        }
+        return text;
+    };
+    for (int round = 0; round < 3000; ++round) {
+        std::string oldText = randomText(24);
+        std::string newText = random() % 4 == 0 ? oldText + randomText(3) : randomText(24);
+        for (DiffAlgorithm algorithm : kAlgorithms) {
+            size_t changed = checkRegions(oldText, newText, algorithm);
+            if (algorithm == DiffAlgorithm::Myers) {
+                LineDiff diff(oldText, newText);
+                CHECK_EQ(changed, diff.oldLines().size() + diff.newLines().size() -
+                                      2 * lcsLength(diff.oldLines(), diff.newLines()));
+            }
+        }
+    }
+}
+
+// Patience and histogram anchor on lines that are unique (rare) on both sides, so a moved
+// block of braces does not pull unrelated lines into the match
+static void testUniqueLineAnchors() {
+    std::string oldText = "int f() {\n  return 1;\n}\n\nint g() {\n  return 2;\n}\n";
+    std::string newText = "int g() {\n  return 2;\n}\n\nint f() {\n  return 1;\n}\n";
+    for (DiffAlgorithm algorithm : kAlgorithms) {
+        checkRegions(oldText, newText, algorithm);
+    }
+    LineDiff patience(oldText, newText, DiffAlgorithm::Patience);
+    LineDiff histogram(oldText, newText, DiffAlgorithm::Histogram);
+    CHECK(!patience.identical());
+    CHECK(!histogram.identical());
+}
+
+int main() {
+    testUnifiedOutput();
+    testSeparateHunks();
+    testRandomTexts();
+    testUniqueLineAnchors();
+    return testResult("test_linediff");
+}
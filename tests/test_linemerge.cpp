@@ -0,0 +1,140 @@
+// Tests for LineMerge: the three-way (diff3) line merge
+
+#include <random>
+#include "TESTING_H.h"
+#include "LINEMERGE_H.h"
+
+static LineMergeResult merge(const std::string& base, const std::string& ours, const std::string& theirs,
+                             MergeFavor favor = MergeFavor::None) {
+    return LineMerge::merge(base, ours, theirs, "ours", "theirs", favor);
+}
+
+static void testSeparateRegionsCombine() {
+    LineMergeResult result = merge("a\nb\nc\nd\ne\n", "A\nb\nc\nd\ne\n", "a\nb\nc\nd\nE\n");
+    CHECK_EQ(result.conflicts, 0u);
+    CHECK_EQ(result.text, "A\nb\nc\nd\nE\n");
+}
+
+static void testIdenticalEditsTakenOnce() {
+    LineMergeResult result = merge("a\nb\nc\n", "a\nB\nc\nd\n", "a\nB\nc\nd\n");
+    CHECK_EQ(result.conflicts, 0u);
+    CHECK_EQ(result.text, "a\nB\nc\nd\n");
+}
+
+// Lines both versions of a conflict start or end with stay outside the markers
+static void testConflictKeepsCommonLinesOutside() {
+    LineMergeResult result = merge("a\nb\nc\n", "a\nx\nsame\nc\n", "a\ny\nsame\nc\n");
+    CHECK_EQ(result.conflicts, 1u);
+    CHECK_EQ(result.text, "a\n<<<<<<< ours\nx\n=======\ny\n>>>>>>> theirs\nsame\nc\n");
+}
+
+// Edits that touch (no unchanged line between them) conflict
+static void testAdjacentEditsConflict() {
+    LineMergeResult result = merge("a\nb\nc\nd\n", "a\nB\nc\nd\n", "a\nb\nC\nd\n");
+    CHECK_EQ(result.conflicts, 1u);
+    CHECK_EQ(result.text, "a\n<<<<<<< ours\nB\nc\n=======\nb\nC\n>>>>>>> theirs\nd\n");
+}
+
+// A file both sides added is merged against an empty base
+static void testBothAdded() {
+    CHECK_EQ(merge("", "same\n", "same\n").conflicts, 0u);
+    LineMergeResult result = merge("", "one\n", "two\n");
+    CHECK_EQ(result.conflicts, 1u);
+    CHECK_EQ(result.text, "<<<<<<< ours\none\n=======\ntwo\n>>>>>>> theirs\n");
+}
+
+// Markers start on a line of their own even after a last line without '\n'
+static void testMissingFinalNewline() {
+    LineMergeResult result = merge("a\nb", "a\nx", "a\ny");
+    CHECK_EQ(result.conflicts, 1u);
+    CHECK_EQ(result.text, "a\n<<<<<<< ours\nx\n=======\ny\n>>>>>>> theirs\n");
+}
+
+static void testFavoredSide() {
+    LineMergeResult ours = merge("a\nb\nc\nd\ne\n", "a\nX\nc\nd\nE\n", "a\nY\nc\nd\ne\n", MergeFavor::Ours);
+    CHECK_EQ(ours.conflicts, 0u);
+    CHECK_EQ(ours.text, "a\nX\nc\nd\nE\n");
+    LineMergeResult theirs = merge("a\nb\nc\nd\ne\n", "a\nX\nc\nd\nE\n", "a\nY\nc\nd\ne\n", MergeFavor::Theirs);
+    CHECK_EQ(theirs.conflicts, 0u);
+    CHECK_EQ(theirs.text, "a\nY\nc\nd\nE\n"); // Ours' edit elsewhere is kept
+}
+
+// Random versions over a small alphabet: a side that did not change gives the other side,
+// identical sides give that version, and swapping the sides does not change whether the
+// merge is clean or its clean result
+static void testRandomProperties() {
+    std::mt19937 random(68);
+    const char* alphabet[] = {"a\n", "b\n", "c\n", "d\n"};
+    auto randomText = [&]() {
+        std::string text;
+        size_t lines = random() % 12;
+        for (size_t i = 0; i < lines; ++i) {
+            text += alphabet[random() % 4];
+        }
+        return text;
+    };
+    for (int round = 0; round < 3000; ++round) {
+        std::string base = randomText(), ours = randomText(), theirs = randomText();
+
+        LineMergeResult onlyOurs = merge(base, ours, base);
+        CHECK_EQ(onlyOurs.conflicts, 0u);
+        CHECK_EQ(onlyOurs.text, ours);
+        LineMergeResult onlyTheirs = merge(base, base, theirs);
+        CHECK_EQ(onlyTheirs.conflicts, 0u);
+        CHECK_EQ(onlyTheirs.text, theirs);
+        LineMergeResult same = merge(base, ours, ours);
+        CHECK_EQ(same.conflicts, 0u);
+        CHECK_EQ(same.text, ours);
+
+        LineMergeResult forward = merge(base, ours, theirs);
+        LineMergeResult backward = merge(base, theirs, ours);
+        CHECK_EQ(forward.conflicts == 0, backward.conflicts == 0);
+        if (forward.conflicts == 0 && backward.conflicts == 0) {
+            CHECK_EQ(forward.text, backward.text);
+        }
+        CHECK_EQ(merge(base, ours, theirs, MergeFavor::Ours).conflicts, 0u);
+        CHECK_EQ(merge(base, ours, theirs, MergeFavor::Theirs).conflicts, 0u);
+    }
+}
+
+// Random edits to separate blocks of a file merge cleanly into both edits. Each block is
+// three distinct lines and only its middle line is edited, so edits of different sides
+// are always separated by unchanged lines.
+static void testRandomDisjointEdits() {
+    std::mt19937 random(680);
+    for (int round = 0; round < 500; ++round) {
+        std::string base, ours, theirs, expected;
+        size_t blocks = 1 + random() % 10;
+        for (size_t b = 0; b < blocks; ++b) {
+            std::string id = std::to_string(b);
+            std::string first = "first " + id + "\n", middle = "middle " + id + "\n", last = "last " + id + "\n";
+            std::string edited;
+            switch (random() % 3) {
+                case 0: edited = ""; break;                                   // Deleted
+                case 1: edited = "edited " + id + "\n"; break;                // Replaced
+                default: edited = middle + "added " + id + "\nmore\n"; break; // Lines added
+            }
+            int owner = random() % 3; // 0: nobody, 1: ours, 2: theirs
+            base += first + middle + last;
+            ours += first + (owner == 1 ? edited : middle) + last;
+            theirs += first + (owner == 2 ? edited : middle) + last;
+            expected += first + (owner == 0 ? middle : edited) + last;
+        }
+        LineMergeResult result = merge(base, ours, theirs);
+        CHECK_EQ(result.conflicts, 0u);
+        CHECK_EQ(result.text, expected);
+    }
+}
+
+int main() {
+    testSeparateRegionsCombine();
+    testIdenticalEditsTakenOnce();
+    testConflictKeepsCommonLinesOutside();
+    testAdjacentEditsConflict();
+    testBothAdded();
+    testMissingFinalNewline();
+    testFavoredSide();
+    testRandomProperties();
+    testRandomDisjointEdits();
+    return testResult("test_linemerge");
+}
@@ -0,0 +1,50 @@
+// Tests for LogGraph: the rows drawn between commits of `log --graph`
+
+#include "TESTING_H.h"
+#include "LOGGRAPH_H.h"
+
+// Nodes only need to be distinct; the graph never looks them up
+static const CommitNode kA1 = 10, kB1 = 11, kTip = 12;
+
+static void testBranchAndAdjacentJoin() {
+    LogGraph graph;
+    CHECK_EQ(graph.commitLine(1), "* ");
+    CHECK_EQ(graph.advance({2, 3}), "|\\\n");     // Merge: second parent opens a lane
+    CHECK_EQ(graph.commitLine(3), "| * ");
+    CHECK_EQ(graph.advance({2}), "|/\n");         // Joins the lane right next to it
+    CHECK_EQ(graph.commitLine(2), "* ");
+    CHECK_EQ(graph.advance({}), "");
+}
+
+// Lanes [A1, B1, tip]; the tip's first parent is A1, two lanes to the left. The joining
+// line has to cross B1's lane instead of ending in it.
+static void testNonAdjacentJoin() {
+    LogGraph graph;
+    graph.commitLine(1);
+    graph.advance({kA1, kB1});
+    CHECK_EQ(graph.commitLine(kTip), "| | * ");
+    CHECK_EQ(graph.advance({kA1, kB1}), "| |/\n|/|\n");
+    CHECK_EQ(graph.commitLine(kB1), "| * ");
+    CHECK_EQ(graph.commitLine(kA1), "* | ");
+}
+
+// Same join with another lane to the right, which moves left in the last row
+static void testNonAdjacentJoinWithLaneOnTheRight() {
+    LogGraph graph;
+    graph.commitLine(1);
+    graph.advance({kA1, kB1});
+    graph.commitLine(5);
+    graph.advance({kTip});
+    graph.commitLine(6);
+    graph.advance({7});
+    CHECK_EQ(graph.commitLine(kTip), "| | * | ");
+    CHECK_EQ(graph.advance({kA1}), "| |/  |\n|/|  /\n");
+    CHECK_EQ(graph.padding(), "| | | ");
+}
+
+int main() {
+    testBranchAndAdjacentJoin();
+    testNonAdjacentJoin();
+    testNonAdjacentJoinWithLaneOnTheRight();
+    return testResult("test_loggraph");
+}
@@ -0,0 +1,185 @@
+// Tests for RenameDetector: pairing deleted and added files into renames and copies
+
+#include <random>
+#include "TESTING_H.h"
+#include "RENAMES_H.h"
+
+// A change list over in-memory file contents
+class Changes {
+public:
+    void deleted(const std::string& path, const std::string& content) { add('D', path, content, ""); }
+    void added(const std::string& path, const std::string& content) { add('A', path, "", content); }
+    void modified(const std::string& path, const std::string& oldContent, const std::string& newContent) {
+        add('M', path, oldContent, newContent);
+    }
+
+    std::vector<RenamePair> detect(int minSimilarity = RenameDetector::kDefaultMinSimilarity, bool findCopies = false) {
+        std::sort(list.begin(), list.end(), [](const TreeChange& a, const TreeChange& b) { return a.path < b.path; });
+        RenameDetector::ContentReader read = [this](const std::string&, const std::string& hash) {
+            ++reads;
+            return contents.at(hash);
+        };
+        return RenameDetector::detect(list, read, read, minSimilarity, findCopies);
+    }
+
+    size_t reads = 0; // Contents read by the last detect()
+
+private:
+    std::vector<TreeChange> list;
+    std::unordered_map<std::string, std::string> contents; // Blob hash -> content
+
+    void add(char status, const std::string& path, const std::string& oldContent, const std::string& newContent) {
+        list.push_back({status, path, hashOf(oldContent, status == 'A'), hashOf(newContent, status == 'D')});
+    }
+
+    std::string hashOf(const std::string& content, bool absent) {
+        if (absent) {
+            return "";
+        }
+        std::string hash = Utils::computeHash(content);
+        contents[hash] = content;
+        return hash;
+    }
+};
+
+// Numbered lines "<prefix> 0" .. "<prefix> n-1"
+static std::string lines(const std::string& prefix, int count) {
+    std::string text;
+    for (int i = 0; i < count; ++i) {
+        text += prefix + " " + std::to_string(i) + "\n";
+    }
+    return text;
+}
+
+static std::string describe(const RenamePair& pair) {
+    return pair.oldPath + (pair.copy ? " => " : " -> ") + pair.newPath + " " + std::to_string(pair.similarity);
+}
+
+static void testExactMoveReadsNothing() {
+    Changes changes;
+    changes.deleted("old/name.txt", lines("x", 5));
+    changes.added("new/name.txt", lines("x", 5));
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "old/name.txt -> new/name.txt 100");
+    CHECK_EQ(changes.reads, 0u);
+}
+
+// Similarity is the share of common lines, relative to the longer version
+static void testSimilarRenameAndThreshold() {
+    std::string oldContent = lines("line", 10);
+    std::string newContent = oldContent;
+    newContent.replace(newContent.find("line 3"), 6, "LINE 3");
+    Changes changes;
+    changes.deleted("a.txt", oldContent);
+    changes.added("b.txt", newContent + "extra\n");
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "a.txt -> b.txt 81"); // 9 of 11 lines
+    CHECK(changes.detect(82).empty());
+}
+
+static void testUnrelatedAndEmptyFilesAreNotPaired() {
+    Changes changes;
+    changes.deleted("a.txt", lines("apple", 10));
+    changes.added("b.txt", lines("banana", 10));
+    changes.deleted("empty1", "");
+    changes.added("empty2", "");
+    CHECK(changes.detect().empty());
+}
+
+// A deleted file moves once; a second identical file is an addition, or a copy with
+// findCopies
+static void testEachSourceMovesOnce() {
+    Changes changes;
+    changes.deleted("src.txt", lines("s", 6));
+    changes.added("one.txt", lines("s", 6));
+    changes.added("two.txt", lines("s", 6));
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "src.txt -> one.txt 100");
+
+    renames = changes.detect(RenameDetector::kDefaultMinSimilarity, true);
+    CHECK_EQ(renames.size(), 2u);
+    if (renames.size() == 2) {
+        CHECK_EQ(describe(renames[0]), "src.txt -> one.txt 100");
+        CHECK_EQ(describe(renames[1]), "src.txt => two.txt 100");
+    }
+}
+
+static void testCopyFromModifiedFile() {
+    Changes changes;
+    changes.modified("kept.txt", lines("k", 8), lines("k", 8) + "more\n");
+    changes.added("copy.txt", lines("k", 8));
+    CHECK(changes.detect().empty());
+    std::vector<RenamePair> renames = changes.detect(RenameDetector::kDefaultMinSimilarity, true);
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "kept.txt => copy.txt 100");
+}
+
+// Equally similar sources: the one with the target's file name wins
+static void testSameBaseNamePreferred() {
+    std::string content = lines("same", 10);
+    Changes changes;
+    changes.deleted("a/other.txt", content + "x\n");
+    changes.deleted("b/target.txt", content + "y\n");
+    changes.added("c/target.txt", content + "z\n");
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "b/target.txt -> c/target.txt 90");
+}
+
+// Binary files have no lines to compare; only exact moves pair them
+static void testBinaryOnlyExact() {
+    std::string binary("\x89PNG\0\0\0\rIHDR", 12);
+    Changes changes;
+    changes.deleted("a.png", binary + lines("x", 10));
+    changes.added("b.png", binary + lines("x", 10) + "y\n");
+    CHECK(changes.detect().empty());
+    changes.added("c.png", binary + lines("x", 10));
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), 1u);
+    if (renames.size() == 1) CHECK_EQ(describe(renames[0]), "a.png -> c.png 100");
+}
+
+// Many moved files with small edits, among unrelated additions and deletions: every
+// moved file finds its own source
+static void testManyRenames() {
+    std::mt19937 random(71);
+    const int kFiles = 5000;
+    Changes changes;
+    for (int i = 0; i < kFiles; ++i) {
+        std::string id = std::to_string(i);
+        std::string content = "// file " + id + "\n" + lines("function " + id + " line", 20);
+        std::string edited = content;
+        edited.insert(edited.find("line 7"), "edited ");
+        if (random() % 2) edited += "appended " + id + "\n";
+        changes.deleted("old/" + id + ".c", content);
+        changes.added("new/" + id + ".cpp", edited);
+        if (i % 10 == 0) {
+            changes.deleted("gone/" + id + ".txt", lines("gone " + id, 5));
+            changes.added("fresh/" + id + ".txt", lines("fresh " + id, 5));
+        }
+    }
+    std::vector<RenamePair> renames = changes.detect();
+    CHECK_EQ(renames.size(), static_cast<size_t>(kFiles));
+    size_t wrong = 0;
+    for (const auto& rename : renames) {
+        std::string oldId = rename.oldPath.substr(4, rename.oldPath.size() - 6);
+        std::string newId = rename.newPath.substr(4, rename.newPath.size() - 8);
+        if (oldId != newId || rename.copy || rename.similarity < 85) ++wrong;
+    }
+    CHECK_EQ(wrong, 0u);
+}
+
+int main() {
+    testExactMoveReadsNothing();
+    testSimilarRenameAndThreshold();
+    testUnrelatedAndEmptyFilesAreNotPaired();
+    testEachSourceMovesOnce();
+    testCopyFromModifiedFile();
+    testSameBaseNamePreferred();
+    testBinaryOnlyExact();
+    testManyRenames();
+    return testResult("test_renames");
+}
@@ -0,0 +1,163 @@
+// Tests for Repository: commands run against a repository in a temporary directory
+
+#include <sstream>
+#include <unistd.h>
+#include "TESTING_H.h"
+#include "REPOSITORY_H.h"
+
+// A fresh working directory with an initialized repository, removed again at the end.
+// Command output is swallowed; only the results are checked.
+class TestRepo {
+public:
+    explicit TestRepo(const std::string& name)
+        : dir(std::filesystem::temp_directory_path() / ("minigit-test-" + name + "-" + std::to_string(getpid()))),
+          savedOut(std::cout.rdbuf(output.rdbuf())), savedErr(std::cerr.rdbuf(output.rdbuf())) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        repo = std::make_unique<Repository>(dir);
+        repo->init();
+    }
+    ~TestRepo() {
+        std::cout.rdbuf(savedOut);
+        std::cerr.rdbuf(savedErr);
+        std::filesystem::remove_all(dir);
+    }
+
+    Repository& operator*() { return *repo; }
+    Repository* operator->() { return repo.get(); }
+
+    void write(const std::string& path, const std::string& content) {
+        std::filesystem::create_directories((dir / path).parent_path());
+        Utils::writeFile((dir / path).string(), content);
+    }
+    std::string read(const std::string& path) { return Utils::readFile((dir / path).string()); }
+    bool exists(const std::string& path) { return std::filesystem::exists(dir / path); }
+
+    // Output of a status command
+    std::string status() {
+        output.str("");
+        repo->status();
+        return output.str();
+    }
+
+    // Subjects of the commits a log command shows, one per line
+    std::string log(LogOptions options) {
+        options.oneline = true;
+        output.str("");
+        repo->log(options);
+        std::string subjects, line;
+        std::istringstream lines(output.str());
+        while (std::getline(lines, line)) {
+            subjects += line.substr(line.find(' ') + 1) + "\n";
+        }
+        return subjects;
+    }
+
+    // Write a commit with an empty tree and the given time straight to the object store
+    std::string commitAt(const std::string& message, int64_t time, const std::vector<std::string>& parents) {
+        std::filesystem::path objectsDir = dir / ".minigit" / "objects";
+        Commit commit(message);
+        for (const auto& parent : parents) {
+            commit.addParent(parent);
+        }
+        commit.setTree(Tree::applyChanges(objectsDir, "", {}), objectsDir);
+        commit.setTime(time, 0);
+        commit.saveToObjectStore(objectsDir);
+        return commit.getHash();
+    }
+
+private:
+    std::filesystem::path dir;
+    std::ostringstream output;
+    std::streambuf* savedOut;
+    std::streambuf* savedErr;
+    std::unique_ptr<Repository> repo;
+};
+
+// A tracked .gitignore is an ordinary file: it does not show as deleted and does not
+// block switching branches
+static void testTrackedGitignore() {
+    TestRepo repo("gitignore");
+    repo.write("a", "a\n");
+    CHECK(repo->add(".gitignore") && repo->add("a"));
+    CHECK(repo->commit("first"));
+    CHECK(repo.status().find(".gitignore") == std::string::npos);
+
+    CHECK(repo->branch("b"));
+    CHECK(repo->checkout("b"));
+    repo.write(".gitignore", ".minigit/\n*.o\n");
+    CHECK(repo->add(".gitignore"));
+    CHECK(repo->commit("ignore objects"));
+    CHECK(repo->checkout("master"));
+    CHECK_EQ(repo.read(".gitignore"), ".minigit/\n");
+    CHECK(repo->merge("b"));
+    CHECK_EQ(repo.read(".gitignore"), ".minigit/\n*.o\n");
+}
+
+// An untracked .gitignore is still not listed
+static void testUntrackedGitignoreNotListed() {
+    TestRepo repo("untracked");
+    repo.write("a", "a\n");
+    std::string status = repo.status();
+    CHECK(status.find(".gitignore") == std::string::npos);
+    CHECK(status.find("\ta\n") != std::string::npos);
+}
+
+// rm takes files only: a tracked directory is refused and left alone, index included
+static void testRemoveRefusesDirectory() {
+    TestRepo repo("rm");
+    repo.write("d/x", "x\n");
+    repo.write("d/y", "y\n");
+    CHECK(repo->add("d/x") && repo->add("d/y"));
+    CHECK(repo->commit("first"));
+
+    CHECK(!repo->remove("d", false));
+    CHECK(!repo->remove("d/", true));
+    CHECK(repo.exists("d/x") && repo.exists("d/y"));
+    CHECK(repo.status().find("deleted") == std::string::npos);
+
+    CHECK(repo->remove("d/x", false));
+    CHECK(!repo.exists("d/x"));
+    CHECK(repo->commit("remove x"));
+    CHECK(repo.status().find("deleted") == std::string::npos);
+    CHECK(repo.exists("d/y"));
+}
+
+// One commit with a clock far behind its parent's: --since still shows the older commits
+// below it that are in range
+static void testSinceSkippedSkewedCommit() {
+    TestRepo repo("since");
+    std::string first = repo.commitAt("first", 1000, {});
+    std::string second = repo.commitAt("second", 2000, {first});
+    std::string skewed = repo.commitAt("skewed", 500, {second});
+    std::string last = repo.commitAt("last", 3000, {skewed});
+    LogOptions options;
+    options.revisions = {last};
+    CHECK_EQ(repo.log(options), "last\nskewed\nsecond\nfirst\n");
+    options.since = 1800;
+    CHECK_EQ(repo.log(options), "last\nsecond\n");
+}
+
+// The excluded end of a range has a clock behind the commit it hides: that commit is
+// still left out, though date order would pop it first
+static void testRangeHidesPastSkewedCommit() {
+    TestRepo repo("range");
+    std::string base = repo.commitAt("base", 1000, {});
+    std::string shared = repo.commitAt("shared", 3000, {base});
+    std::string skewed = repo.commitAt("skewed", 500, {shared});
+    std::string tip = repo.commitAt("tip", 4000, {shared});
+    LogOptions options;
+    options.revisions = {skewed + ".." + tip};
+    CHECK_EQ(repo.log(options), "tip\n");
+    options.revisions = {tip + ".." + skewed};
+    CHECK_EQ(repo.log(options), "skewed\n");
+}
+
+int main() {
+    testTrackedGitignore();
+    testUntrackedGitignoreNotListed();
+    testRemoveRefusesDirectory();
+    testSinceSkippedSkewedCommit();
+    testRangeHidesPastSkewedCommit();
+    return testResult("test_repository");
+}
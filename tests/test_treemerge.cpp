@@ -0,0 +1,195 @@
+// Tests for TreeMerger: merging trees and commits in the object store. File merges run on
+// a thread pool, so this is also worth running built with -fsanitize=thread.
+
+#include <map>
+#include <unistd.h>
+#include "TESTING_H.h"
+#include "TREEMERGE_H.h"
+#include "COMMIT_H.h"
+
+// An object store in a fresh temporary directory, removed again at the end
+class TestStore {
+public:
+    explicit TestStore(const std::string& name)
+        : dir(std::filesystem::temp_directory_path() / ("minigit-test-" + name + "-" + std::to_string(getpid()))) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+    ~TestStore() { std::filesystem::remove_all(dir); }
+
+    const std::filesystem::path& path() const { return dir; }
+
+    std::string blob(const std::string& content) {
+        std::string hash = Utils::computeHash(content);
+        Utils::writeObject(dir, hash, content);
+        return hash;
+    }
+
+    // A root tree holding the given files (path -> content)
+    std::string tree(const std::map<std::string, std::string>& files) {
+        std::map<std::string, std::string> changes;
+        for (const auto& [path, content] : files) {
+            changes[path] = blob(content);
+        }
+        return Tree::applyChanges(dir, "", changes);
+    }
+
+    std::string commit(const std::string& message, const std::string& treeHash, const std::vector<std::string>& parents) {
+        Commit commit(message);
+        for (const auto& parent : parents) {
+            commit.addParent(parent);
+        }
+        commit.setTree(treeHash, dir);
+        commit.saveToObjectStore(dir);
+        return commit.getHash();
+    }
+
+    // Content of a file in a tree ("<missing>" if there is none)
+    std::string file(const std::string& treeHash, const std::string& path) {
+        std::string hash = Tree::lookupPath(dir, treeHash, path);
+        return hash.empty() ? "<missing>" : Utils::readFile(Utils::objectPath(dir, hash));
+    }
+
+    // Every file of a tree as "path hash" lines
+    std::string listing(const std::string& treeHash) {
+        Snapshot snapshot;
+        Tree::flatten(dir, treeHash, "", snapshot);
+        std::string lines;
+        for (const auto& entry : snapshot) {
+            lines += std::string(entry.path) + " " + entry.id.toString() + "\n";
+        }
+        return lines;
+    }
+
+private:
+    std::filesystem::path dir;
+};
+
+// Everything a merge reports, as text to compare
+static std::string describe(const TreeMergeResult& result, TestStore& store) {
+    std::string text = store.listing(result.tree);
+    for (const auto& change : result.changes) {
+        text += std::string(1, change.status) + " " + change.path + " " + change.oldHash + " " + change.newHash + "\n";
+    }
+    for (const auto& conflict : result.conflicts) {
+        text += "conflict " + conflict.path + " " + conflict.kind + " " + conflict.hash + "\n";
+    }
+    for (const auto& message : result.messages) {
+        text += message + "\n";
+    }
+    return text;
+}
+
+// Three versions of many files: some changed by one side, some by both in separate
+// regions, some conflicting, some deleted on one side; several files merge to the same
+// content, so their merged blob is written once
+static void buildManyFiles(TestStore& store, std::string& base, std::string& ours, std::string& theirs) {
+    std::map<std::string, std::string> baseFiles, oursFiles, theirsFiles;
+    for (int i = 0; i < 300; ++i) {
+        std::string path = "dir" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".txt";
+        std::string id = i % 5 == 4 ? "shared" : std::to_string(i); // Every fifth file has the same content
+        std::string head = "head " + id + "\n", middle = "a\nb\nc\n", tail = "tail " + id + "\n";
+        baseFiles[path] = head + middle + tail;
+        switch (i % 5) {
+            case 0: // Ours only
+                oursFiles[path] = "ours " + head + middle + tail;
+                theirsFiles[path] = baseFiles[path];
+                break;
+            case 1: // Both, in separate regions
+            case 4:
+                oursFiles[path] = "ours " + head + middle + tail;
+                theirsFiles[path] = head + middle + "theirs " + tail;
+                break;
+            case 2: // Conflict
+                oursFiles[path] = head + "a\nours\nc\n" + tail;
+                theirsFiles[path] = head + "a\ntheirs\nc\n" + tail;
+                break;
+            case 3: // Deleted by theirs, changed by ours
+                oursFiles[path] = head + "changed\n" + tail;
+                break;
+        }
+    }
+    base = store.tree(baseFiles);
+    ours = store.tree(oursFiles);
+    theirs = store.tree(theirsFiles);
+}
+
+// Files merged on the thread pool give exactly what a serial merge gives
+static void testParallelMergeMatchesSerial() {
+    TestStore serialStore("serial"), parallelStore("parallel");
+    std::string base, ours, theirs;
+    buildManyFiles(serialStore, base, ours, theirs);
+    buildManyFiles(parallelStore, base, ours, theirs);
+
+    CommitGraph serialGraph(serialStore.path()), parallelGraph(parallelStore.path());
+    TreeMerger serial(serialStore.path(), serialGraph, 1);
+    TreeMerger parallel(parallelStore.path(), parallelGraph, 8);
+    const TreeMergeResult& serialResult = serial.mergeTrees(base, ours, theirs, "HEAD", "other");
+    const TreeMergeResult& parallelResult = parallel.mergeTrees(base, ours, theirs, "HEAD", "other");
+    CHECK(!serialResult.failed);
+    CHECK(!parallelResult.failed);
+    CHECK_EQ(serialResult.conflicts.size(), 120u); // 60 content, 60 modify/delete
+    CHECK_EQ(describe(parallelResult, parallelStore), describe(serialResult, serialStore));
+
+    CHECK_EQ(parallelStore.file(parallelResult.tree, "dir1/file1.txt"), "ours head 1\na\nb\nc\ntheirs tail 1\n");
+    CHECK_EQ(parallelStore.file(parallelResult.tree, "dir4/file4.txt"), "ours head shared\na\nb\nc\ntheirs tail shared\n");
+    CHECK_EQ(parallelStore.file(parallelResult.tree, "dir2/file2.txt"),
+             "head 2\na\n<<<<<<< HEAD\nours\n=======\ntheirs\n>>>>>>> other\nc\ntail 2\n");
+
+    // The pool is kept for later merges in the same merger
+    const TreeMergeResult& again = parallel.mergeTrees(base, theirs, ours, "HEAD", "other");
+    CHECK(!again.failed);
+    CHECK_EQ(again.conflicts.size(), 120u);
+}
+
+// Three merge bases X, Y and Z, where X and Z share a commit W that Y does not have:
+//
+//   O -- W -- X --+-- P
+//   |    \        |
+//   |     `-- Z --+-- Q   (P and Q both merge X, Y and Z)
+//   `-- Y --------'
+//
+// f is "1" in O, "2" in W and X, "3" in Z, and untouched by Y. Folding Z into the virtual
+// ancestor of X and Y must use W as the base (the base of Z with X and Y together), which
+// gives f = "3" cleanly. The base of Y and Z alone is O, where X's and Z's edits to f
+// would conflict.
+static void testThreeMergeBases() {
+    TestStore store("bases");
+    std::string o = store.commit("O", store.tree({{"f", "1\n"}, {"y", "y0\n"}}), {});
+    std::string w = store.commit("W", store.tree({{"f", "2\n"}, {"y", "y0\n"}}), {o});
+    std::string x = store.commit("X", store.tree({{"f", "2\n"}, {"y", "y0\n"}, {"x", "x\n"}}), {w});
+    std::string z = store.commit("Z", store.tree({{"f", "3\n"}, {"y", "y0\n"}}), {w});
+    std::string y = store.commit("Y", store.tree({{"f", "1\n"}, {"y", "y1\n"}}), {o});
+    std::string mergedTree = store.tree({{"f", "3\n"}, {"y", "y1\n"}, {"x", "x\n"}});
+    std::string p = store.commit("P", store.tree({{"f", "4\n"}, {"y", "y1\n"}, {"x", "x\n"}}), {x, y, z});
+    std::string q = store.commit("Q", mergedTree, {x, z, y});
+
+    CommitGraph graph(store.path());
+    CommitNode nodeX, nodeY, nodeZ, nodeP, nodeQ, nodeW;
+    CHECK(graph.lookup(x, nodeX) && graph.lookup(y, nodeY) && graph.lookup(z, nodeZ) &&
+          graph.lookup(p, nodeP) && graph.lookup(q, nodeQ) && graph.lookup(w, nodeW));
+
+    std::vector<CommitNode> bases = graph.findMergeBases(nodeP, nodeQ);
+    CHECK_EQ(bases.size(), 3u);
+    CHECK(graph.findMergeBases({nodeX, nodeY}, nodeZ) == std::vector<CommitNode>{nodeW});
+
+    TreeMerger merger(store.path(), graph);
+    for (const auto& order : {std::vector<CommitNode>{nodeX, nodeY, nodeZ}, std::vector<CommitNode>{nodeY, nodeZ, nodeX},
+                              std::vector<CommitNode>{nodeZ, nodeX, nodeY}}) {
+        std::string virtualTree;
+        CHECK(merger.virtualAncestorTree(order, virtualTree));
+        CHECK_EQ(virtualTree, mergedTree);
+    }
+
+    // P changed f on top of everything; Q did not, so P's version wins
+    TreeMergeResult result = merger.mergeCommits(nodeP, nodeQ, "P", "Q");
+    CHECK(!result.failed);
+    CHECK(result.conflicts.empty());
+    CHECK_EQ(store.file(result.tree, "f"), "4\n");
+}
+
+int main() {
+    testParallelMergeMatchesSerial();
+    testThreeMergeBases();
+    return testResult("test_treemerge");
+}